@@ -0,0 +1,182 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "dylib.hpp"
+
+static const char *library_name(std::int64_t symbols) {
+    switch (symbols) {
+    case 10:
+        return "generated_lib_10";
+    case 1000:
+        return "generated_lib_1k";
+    default:
+        return "generated_lib_100k";
+    }
+}
+
+static std::vector<std::string> symbol_names(std::int64_t symbols) {
+    std::size_t digits = 0;
+    for (std::int64_t i = symbols; i > 1; i /= 10)
+        digits++;
+
+    std::vector<std::string> names;
+    for (std::int64_t i = 0; i < symbols; i++) {
+        std::string index = std::to_string(i);
+        names.push_back("symbol_" + std::string(digits - index.size(), '0') + index);
+    }
+    return names;
+}
+
+#if defined(__GNUC__)
+__attribute__((noinline))
+#elif defined(_MSC_VER)
+__declspec(noinline)
+#endif
+int direct_symbol(int value) {
+    return value + 1;
+}
+
+static void load_unload(benchmark::State &state) {
+    for (auto _ : state) {
+        dylib lib("./", library_name(state.range(0)));
+        benchmark::DoNotOptimize(lib.native_handle());
+    }
+}
+BENCHMARK(load_unload)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void get_symbol_hit(benchmark::State &state) {
+    dylib lib("./", library_name(state.range(0)));
+    const auto names = symbol_names(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lib.get_symbol(names[i].c_str()));
+        i = (i + 1) % names.size();
+    }
+}
+BENCHMARK(get_symbol_hit)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void get_symbol_cached_hit(benchmark::State &state) {
+    dylib lib("./", library_name(state.range(0)));
+    lib.enable_symbol_cache();
+    const auto names = symbol_names(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lib.get_symbol(names[i].c_str()));
+        i = (i + 1) % names.size();
+    }
+}
+BENCHMARK(get_symbol_cached_hit)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void get_symbol_cached_name(benchmark::State &state) {
+    dylib lib("./", library_name(10));
+    lib.enable_symbol_cache();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(lib.get_symbol("symbol_7"));
+}
+BENCHMARK(get_symbol_cached_name);
+
+static void get_symbol_cached_key(benchmark::State &state) {
+    dylib lib("./", library_name(10));
+    lib.enable_symbol_cache();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(lib.get_symbol(DYLIB_SYMBOL("symbol_7")));
+}
+BENCHMARK(get_symbol_cached_key);
+
+static void get_symbol_miss(benchmark::State &state) {
+    dylib lib("./", library_name(state.range(0)));
+    for (auto _ : state) {
+        try {
+            lib.get_symbol("missing_symbol");
+        } catch (const dylib::symbol_error &e) {
+            benchmark::DoNotOptimize(e.what());
+        }
+    }
+}
+BENCHMARK(get_symbol_miss)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void try_get_symbol_miss(benchmark::State &state) {
+    dylib lib("./", library_name(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(lib.try_get_symbol("missing_symbol").get());
+}
+BENCHMARK(try_get_symbol_miss)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void has_symbol(benchmark::State &state) {
+    dylib lib("./", library_name(state.range(0)));
+    const auto names = symbol_names(state.range(0));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lib.has_symbol(names[i].c_str()));
+        i = (i + 1) % names.size();
+    }
+}
+BENCHMARK(has_symbol)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void exported_symbols(benchmark::State &state) {
+    dylib lib("./", library_name(state.range(0)));
+    for (auto _ : state) {
+        std::size_t count = 0;
+        for (auto &symbol : lib.exported_symbols()) {
+            benchmark::DoNotOptimize(symbol.address);
+            count++;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+}
+BENCHMARK(exported_symbols)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void find_symbols(benchmark::State &state) {
+    dylib lib("./", library_name(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(lib.find_symbols("symbol_1"));
+}
+BENCHMARK(find_symbols)->Arg(10)->Arg(1000)->Arg(100000);
+
+static void call_direct(benchmark::State &state) {
+    auto function = &direct_symbol;
+    benchmark::DoNotOptimize(function);
+    int value = 0;
+    for (auto _ : state) {
+        value = function(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(call_direct);
+
+static void call_resolved(benchmark::State &state) {
+    dylib lib("./", library_name(10));
+    auto function = lib.get_function<int(int)>("symbol_0");
+    int value = 0;
+    for (auto _ : state) {
+        value = function(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(call_resolved);
+
+static void call_lazy(benchmark::State &state) {
+    dylib lib("./", library_name(10));
+    auto function = lib.get_lazy_function<int(int)>("symbol_0");
+    int value = 0;
+    for (auto _ : state) {
+        value = function(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(call_lazy);
+
+static void call_profiled(benchmark::State &state) {
+    dylib lib("./", library_name(10));
+    auto function = lib.get_profiled_function<int(int)>("symbol_0");
+    dylib::set_profiling(state.range(0) != 0);
+    int value = 0;
+    for (auto _ : state) {
+        value = function(value);
+        benchmark::DoNotOptimize(value);
+    }
+    dylib::set_profiling(false);
+}
+BENCHMARK(call_profiled)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,35 @@
+/*
+ *  Shared library exporting 10^SYMBOL_DIGITS functions, named "symbol_" followed by their
+ *  index zero padded to SYMBOL_DIGITS digits, e.g. "symbol_000" to "symbol_999" for 3 digits
+ */
+
+#if defined(_WIN32) || defined(_WIN64)
+#define LIB_EXPORT __declspec(dllexport)
+#else
+#define LIB_EXPORT
+#endif
+
+#ifndef SYMBOL_DIGITS
+#define SYMBOL_DIGITS 3
+#endif
+
+#define DEFINE_SYMBOL(index) LIB_EXPORT int symbol_##index(int value) { return value + 1; }
+
+#define REPEAT_1(m, p) m(p##0) m(p##1) m(p##2) m(p##3) m(p##4) m(p##5) m(p##6) m(p##7) m(p##8) m(p##9)
+#define REPEAT_2(m, p) REPEAT_1(m, p##0) REPEAT_1(m, p##1) REPEAT_1(m, p##2) REPEAT_1(m, p##3) REPEAT_1(m, p##4) \
+    REPEAT_1(m, p##5) REPEAT_1(m, p##6) REPEAT_1(m, p##7) REPEAT_1(m, p##8) REPEAT_1(m, p##9)
+#define REPEAT_3(m, p) REPEAT_2(m, p##0) REPEAT_2(m, p##1) REPEAT_2(m, p##2) REPEAT_2(m, p##3) REPEAT_2(m, p##4) \
+    REPEAT_2(m, p##5) REPEAT_2(m, p##6) REPEAT_2(m, p##7) REPEAT_2(m, p##8) REPEAT_2(m, p##9)
+#define REPEAT_4(m, p) REPEAT_3(m, p##0) REPEAT_3(m, p##1) REPEAT_3(m, p##2) REPEAT_3(m, p##3) REPEAT_3(m, p##4) \
+    REPEAT_3(m, p##5) REPEAT_3(m, p##6) REPEAT_3(m, p##7) REPEAT_3(m, p##8) REPEAT_3(m, p##9)
+#define REPEAT_5(m, p) REPEAT_4(m, p##0) REPEAT_4(m, p##1) REPEAT_4(m, p##2) REPEAT_4(m, p##3) REPEAT_4(m, p##4) \
+    REPEAT_4(m, p##5) REPEAT_4(m, p##6) REPEAT_4(m, p##7) REPEAT_4(m, p##8) REPEAT_4(m, p##9)
+
+#define REPEAT_EXPANDED(digits, m) REPEAT_##digits(m, )
+#define REPEAT(digits, m) REPEAT_EXPANDED(digits, m)
+
+extern "C" {
+
+REPEAT(SYMBOL_DIGITS, DEFINE_SYMBOL)
+
+} // extern "C"
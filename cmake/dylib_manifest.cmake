@@ -0,0 +1,22 @@
+# Generates a manifest next to a shared library after each build, indexing its
+# exported names and ABI tag so that the loader can filter plugins without opening them
+#
+# dylib_add_manifest(<target> [ABI <tag>])
+
+set(DYLIB_MANIFEST_TOOL_SOURCE "${CMAKE_CURRENT_LIST_DIR}/../tools/dylib_manifest.cpp")
+
+function(dylib_add_manifest target)
+    cmake_parse_arguments(MANIFEST "" "ABI" "" ${ARGN})
+
+    if(NOT TARGET dylib_manifest)
+        add_executable(dylib_manifest ${DYLIB_MANIFEST_TOOL_SOURCE})
+        target_link_libraries(dylib_manifest PRIVATE dylib)
+    endif()
+
+    add_dependencies(${target} dylib_manifest)
+    add_custom_command(TARGET ${target} POST_BUILD
+        COMMAND dylib_manifest "$<TARGET_FILE:${target}>" "$<TARGET_FILE:${target}>.dlmanifest" "${MANIFEST_ABI}"
+        COMMENT "Generating the manifest of ${target}"
+        VERBATIM
+    )
+endfunction()
@@ -12,13 +12,56 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <exception>
+#include <cstring>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#ifdef DYLIB_INSTRUMENTATION
+#include <ostream>
+#endif
 
 #if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
 #define DYLIB_CPP17
 #include <filesystem>
+#include <string_view>
+#endif
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#if defined(__linux__) && defined(__aarch64__)
+#include <sys/auxv.h>
 #endif
 
 #if (defined(_WIN32) || defined(_WIN64))
@@ -33,6 +76,31 @@
 #include <dlfcn.h>
 #endif
 
+#if defined(__GLIBC__) && defined(LM_ID_NEWLM)
+#define DYLIB_DLMOPEN
+#endif
+
+#if defined(__APPLE__)
+// the mach-o headers declare a struct dylib, the few structures read are declared in the dylib class
+struct mach_header;
+extern "C" {
+std::uint32_t _dyld_image_count();
+const struct mach_header *_dyld_get_image_header(std::uint32_t image_index);
+std::intptr_t _dyld_get_image_vmaddr_slide(std::uint32_t image_index);
+const char *_dyld_get_image_name(std::uint32_t image_index);
+int _NSGetExecutablePath(char *buf, std::uint32_t *bufsize);
+}
+#elif !(defined(_WIN32) || defined(_WIN64))
+#include <link.h>
+#endif
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sched.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#endif
+
 #if (defined(_WIN32) || defined(_WIN64))
 #define DYLIB_WIN_MAC_OTHER(win_def, mac_def, other_def) win_def
 #define DYLIB_WIN_OTHER(win_def, other_def) win_def
@@ -44,6 +112,12 @@
 #define DYLIB_WIN_OTHER(win_def, other_def) other_def
 #endif
 
+/**
+ *  Builds a dylib::symbol_key from a string literal, its hash being computed at compile time
+ */
+#define DYLIB_SYMBOL(name) \
+    (::dylib::symbol_key::precomputed<std::integral_constant<std::uint64_t, ::dylib::symbol_key::hash_of(name)>::value>(name))
+
 /**
  *  The dylib class can hold a dynamic library instance and interact with it 
  *  by getting its symbols like functions or global variables
@@ -63,6 +137,56 @@ public:
     static constexpr bool add_filename_decorations = true;
     static constexpr bool no_filename_decorations = false;
 
+    /**
+     *  Flags controlling how a dynamic library is loaded. They can be combined with operator|,
+     *  and each flag is ignored on the platforms that have no equivalent for it
+     */
+    enum class load_options : unsigned {
+        /** Bind every symbol at load time, with local visibility (RTLD_NOW | RTLD_LOCAL, LoadLibraryA) */
+        defaults = 0,
+        /** Bind function symbols on first call instead of at load time (RTLD_LAZY) */
+        lazy = 1u << 0,
+        /** Make the symbols of the library available to the libraries loaded afterwards (RTLD_GLOBAL) */
+        global = 1u << 1,
+        /** Never unload the library from the process, even once closed (RTLD_NODELETE, pinned module on Windows) */
+        nodelete = 1u << 2,
+        /** Prefer the symbols of the library over global symbols with the same name (RTLD_DEEPBIND) */
+        deepbind = 1u << 3,
+        /** Search the dependencies in the directory of the library (LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR) */
+        search_dll_load_dir = 1u << 4,
+        /** Search the dependencies in the directory of the application (LOAD_LIBRARY_SEARCH_APPLICATION_DIR) */
+        search_application_dir = 1u << 5,
+        /** Search the dependencies in the directories added with AddDllDirectory (LOAD_LIBRARY_SEARCH_USER_DIRS) */
+        search_user_dirs = 1u << 6,
+        /** Search the dependencies in the system directory (LOAD_LIBRARY_SEARCH_SYSTEM32) */
+        search_system32 = 1u << 7,
+        /** Search the dependencies in the default directories (LOAD_LIBRARY_SEARCH_DEFAULT_DIRS) */
+        search_default_dirs = 1u << 8,
+        /** Map the library without loading its dependencies nor running its initialization (DONT_RESOLVE_DLL_REFERENCES) */
+        dont_resolve_dll_references = 1u << 9,
+        /** Fault the executable segments in once loaded, see prefault */
+        prefault_text = 1u << 10,
+        /** Fault every loaded segment in once loaded, see prefault */
+        prefault_all = 1u << 11,
+        /** Lock the prefaulted pages in memory, prefaulting the executable segments if no other prefault flag is given */
+        lock_pages = 1u << 12,
+        /** Remap the code onto transparent huge pages once loaded, see remap_huge_pages (Linux only) */
+        huge_pages = 1u << 13,
+        /** Hand the library to a background thread to be closed, instead of closing it on the destroying thread */
+        deferred_close = 1u << 14,
+        /** Load a private instance of the library, with its own globals, every time (dlmopen(LM_ID_NEWLM) with glibc,
+            a copy of the file at a unique path elsewhere). RTLD_GLOBAL does not apply to a private namespace */
+        isolated = 1u << 15,
+    };
+
+    friend constexpr load_options operator|(load_options lhs, load_options rhs) noexcept {
+        return static_cast<load_options>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+    }
+
+    friend constexpr load_options operator&(load_options lhs, load_options rhs) noexcept {
+        return static_cast<load_options>(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+    }
+
     /**
      *  This exception is raised when the library failed to load a dynamic library or a symbol
      *
@@ -93,16 +217,723 @@ public:
         explicit symbol_error(const std::string &message) : exception(message) {}
     };
 
+    /**
+     *  The reasons why a non-throwing symbol lookup can fail
+     */
+    enum class symbol_errc {
+        /** the symbol was found */
+        none = 0,
+        /** the symbol name is nullptr */
+        null_name,
+        /** no dynamic library is currently loaded in the object */
+        null_handle,
+        /** the symbol could not be found in the dynamic library */
+        not_found,
+    };
+
+    /**
+     *  The outcome of a non-throwing symbol lookup: either the requested pointer or an error code.
+     *  A failed lookup copies the symbol name and the description of the loader into fixed-size
+     *  buffers, truncated if needed, so the result depends neither on the symbol name given to the
+     *  lookup nor on the library once returned, and the message is only built if requested
+     *
+     *  @param T the pointer type of the requested symbol
+     */
+    template<typename T>
+    class symbol_result {
+    public:
+        symbol_result(const symbol_result &) = default;
+        symbol_result(symbol_result &&) = default;
+        symbol_result &operator=(const symbol_result &) = default;
+        symbol_result &operator=(symbol_result &&) = default;
+
+        /**
+         *  @return true if the symbol was found, false otherwise
+         */
+        explicit operator bool() const noexcept {
+            return m_error == symbol_errc::none;
+        }
+
+        /**
+         *  @return the requested pointer, or nullptr if the symbol was not found
+         */
+        T get() const noexcept {
+            return m_value;
+        }
+
+        /**
+         *  @throws std::invalid_argument, std::logic_error or dylib::symbol_error, following
+         *  the exceptions raised by get_symbol, if the symbol was not found
+         *
+         *  @return the requested pointer
+         */
+        T value() const {
+            switch (m_error) {
+            case symbol_errc::none:
+                return m_value;
+            case symbol_errc::null_name:
+                throw std::invalid_argument(message());
+            case symbol_errc::null_handle:
+                throw std::logic_error(message());
+            default:
+                throw symbol_error(message());
+            }
+        }
+
+        /**
+         *  @return the reason why the symbol was not found, or symbol_errc::none if it was found
+         */
+        symbol_errc error() const noexcept {
+            return m_error;
+        }
+
+        /**
+         *  @return the description of the error, or an empty string if the symbol was found
+         */
+        std::string message() const {
+            switch (m_error) {
+            case symbol_errc::none:
+                return std::string();
+            case symbol_errc::null_name:
+                return "Null parameter";
+            case symbol_errc::null_handle:
+                return "The dynamic library handle is null";
+            default:
+                return "Could not get symbol \"" + std::string(m_name) + "\"\n" + m_description;
+            }
+        }
+
+    private:
+        friend class dylib;
+        template<typename U>
+        friend class symbol_result;
+
+        symbol_result(T value, symbol_errc error) noexcept : m_value(value), m_error(error) {
+            m_name[0] = '\0';
+            m_description[0] = '\0';
+        }
+
+        symbol_result(symbol_errc error, const char *name, const char *description) noexcept
+            : m_value(nullptr), m_error(error) {
+            std::snprintf(m_name, sizeof(m_name), "%s", name);
+            std::snprintf(m_description, sizeof(m_description), "%s", description);
+        }
+
+        template<typename U>
+        symbol_result(T value, const symbol_result<U> &other) noexcept : m_value(value), m_error(other.m_error) {
+            std::memcpy(m_name, other.m_name, sizeof(m_name));
+            std::memcpy(m_description, other.m_description, sizeof(m_description));
+        }
+
+        T m_value;
+        symbol_errc m_error;
+        char m_name[256];
+        char m_description[512];  // as captured by lookup_error
+    };
+
+    template<typename T>
+    class lazy_function;
+
+    /**
+     *  A function handle that resolves its symbol on first invocation, then calls straight
+     *  through the resolved pointer. Concurrent first calls are safe, they all resolve the
+     *  same address. The handle must not be used after the library has been closed
+     *
+     *  @throws dylib::symbol_error on invocation if the symbol could not be found
+     */
+    template<typename R, typename... Args>
+    class lazy_function<R(Args...)> {
+    public:
+        lazy_function(const lazy_function &other)
+            : m_handle(other.m_handle), m_name(other.m_name), m_function(other.m_function.load(std::memory_order_acquire)) {}
+
+        lazy_function& operator=(const lazy_function &other) {
+            if (this != &other) {
+                m_handle = other.m_handle;
+                m_name = other.m_name;
+                m_function.store(other.m_function.load(std::memory_order_acquire), std::memory_order_release);
+            }
+            return *this;
+        }
+
+        R operator()(Args... args) const {
+            return get()(std::forward<Args>(args)...);
+        }
+
+        /**
+         *  @return a pointer to the function, resolving it if it was not already
+         */
+        R (*get() const)(Args...) {
+            auto function = m_function.load(std::memory_order_acquire);
+            if (function != nullptr)
+                return function;
+
+            auto symbol = locate_symbol(m_handle, m_name.c_str());
+            if (symbol == nullptr)
+                throw symbol_error("Could not get symbol \"" + m_name + "\"\n" + lookup_error_description());
+            function = function_cast<R(Args...)>(symbol);
+            m_function.store(function, std::memory_order_release);
+            return function;
+        }
+
+        /**
+         *  @return true if the symbol was already resolved, false otherwise
+         */
+        bool resolved() const noexcept {
+            return m_function.load(std::memory_order_acquire) != nullptr;
+        }
+
+    private:
+        friend class dylib;
+
+        lazy_function(native_handle_type handle, const char *name)
+            : m_handle(handle), m_name(name), m_function(nullptr) {}
+
+        native_handle_type m_handle;
+        std::string m_name;
+        mutable std::atomic<R (*)(Args...)> m_function;
+    };
+
+    /**
+     *  A handle to a variable of a library, resolved once then read or written straight through
+     *  the stored address. It is a single pointer, cheap to copy into per-thread contexts.
+     *  The handle must not be used after the library has been closed
+     *
+     *  @param T the type of the variable
+     */
+    template<typename T>
+    class variable_ref {
+    public:
+        variable_ref() noexcept = default;
+
+        T &get() const noexcept {
+            return *m_address;
+        }
+
+        T &operator*() const noexcept {
+            return *m_address;
+        }
+
+        T *operator->() const noexcept {
+            return m_address;
+        }
+
+        /**
+         *  @return the address of the variable, or nullptr for a default constructed handle
+         */
+        T *address() const noexcept {
+            return m_address;
+        }
+
+        explicit operator bool() const noexcept {
+            return m_address != nullptr;
+        }
+
+        /**
+         *  Atomically read the variable, which must be trivially copyable and of a lock-free size
+         *
+         *  @param order the memory ordering of the load
+         *
+         *  @return the value of the variable
+         */
+        T load(std::memory_order order = std::memory_order_seq_cst) const noexcept {
+            check_atomic();
+#if defined(__cpp_lib_atomic_ref)
+            return std::atomic_ref<T>(*m_address).load(order);
+#elif defined(__GNUC__)
+            T value;
+            __atomic_load(m_address, &value, builtin_order(order));
+            return value;
+#else
+            return reinterpret_cast<const std::atomic<T> *>(m_address)->load(order);
+#endif
+        }
+
+        /**
+         *  Atomically write the variable, which must be trivially copyable and of a lock-free size
+         *
+         *  @param value the value to write
+         *  @param order the memory ordering of the store
+         */
+        void store(T value, std::memory_order order = std::memory_order_seq_cst) const noexcept {
+            check_atomic();
+#if defined(__cpp_lib_atomic_ref)
+            std::atomic_ref<T>(*m_address).store(value, order);
+#elif defined(__GNUC__)
+            __atomic_store(m_address, &value, builtin_order(order));
+#else
+            reinterpret_cast<std::atomic<T> *>(m_address)->store(value, order);
+#endif
+        }
+
+    private:
+        friend class dylib;
+
+        explicit variable_ref(T *address) noexcept : m_address(address) {}
+
+        T *m_address{nullptr};
+
+        static void check_atomic() noexcept {
+            static_assert(std::is_trivially_copyable<T>::value, "atomic access requires a trivially copyable type");
+            static_assert(sizeof(T) <= sizeof(std::uint64_t) && (sizeof(T) & (sizeof(T) - 1)) == 0,
+                "atomic access requires a lock-free size");
+        }
+
+#if defined(__GNUC__)
+        static int builtin_order(std::memory_order order) noexcept {
+            switch (order) {
+            case std::memory_order_relaxed:
+                return __ATOMIC_RELAXED;
+            case std::memory_order_consume:
+                return __ATOMIC_CONSUME;
+            case std::memory_order_acquire:
+                return __ATOMIC_ACQUIRE;
+            case std::memory_order_release:
+                return __ATOMIC_RELEASE;
+            case std::memory_order_acq_rel:
+                return __ATOMIC_ACQ_REL;
+            default:
+                return __ATOMIC_SEQ_CST;
+            }
+        }
+#endif
+    };
+
+    /**
+     *  A range of the latency histogram of a profiled function, see call_profile
+     */
+    struct latency_bucket {
+        /** the calls of this bucket took less than this duration, and at least the bound of the previous bucket */
+        std::chrono::nanoseconds upper_bound;
+        /** the number of calls in this bucket */
+        std::uint64_t calls;
+    };
+
+    /**
+     *  The counters of a profiled function, see call_profiler::snapshot
+     */
+    struct call_profile {
+        /** the symbol name of the function */
+        std::string symbol;
+        /** the number of calls made while profiling was enabled */
+        std::uint64_t calls;
+        /** the time spent in these calls */
+        std::chrono::nanoseconds total_time;
+        /** the longest of these calls */
+        std::chrono::nanoseconds max_time;
+        /** the latencies of these calls in power of two buckets, up to the last non empty bucket */
+        std::vector<latency_bucket> histogram;
+
+        /**
+         *  @return the mean time of a call, or zero without calls
+         */
+        std::chrono::nanoseconds mean_time() const noexcept {
+            return calls ? total_time / static_cast<std::chrono::nanoseconds::rep>(calls) : std::chrono::nanoseconds(0);
+        }
+
+        /**
+         *  @param fraction the fraction of the calls, between 0 and 1, e.g. 0.99 for the 99th percentile
+         *
+         *  @return the upper bound of the bucket holding the given percentile of the latencies
+         */
+        std::chrono::nanoseconds percentile(double fraction) const noexcept {
+            const double target = fraction * static_cast<double>(calls);
+            std::uint64_t seen = 0;
+            for (const auto &bucket : histogram) {
+                seen += bucket.calls;
+                if (bucket.calls && static_cast<double>(seen) >= target)
+                    return bucket.upper_bound;
+            }
+            return histogram.empty() ? std::chrono::nanoseconds(0) : histogram.back().upper_bound;
+        }
+    };
+
+    template<typename T>
+    class profiled_function;
+
+    /**
+     *  Accumulates the calls of a profiled function. Each thread counts its calls in its own
+     *  shard without synchronization, and the shards are merged when a snapshot is taken.
+     *  Every profiled handle of the same function shares one profiler
+     */
+    class call_profiler {
+    public:
+        call_profiler(const call_profiler &) = delete;
+        call_profiler& operator=(const call_profiler &) = delete;
+
+        /**
+         *  @return the symbol name of the profiled function
+         */
+        const std::string &symbol() const noexcept {
+            return m_symbol;
+        }
+
+        /**
+         *  @return the merged counters of every thread
+         */
+        call_profile snapshot() const {
+            std::uint64_t buckets[histogram_size] = {};
+            call_profile profile{m_symbol, 0, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0), {}};
+            std::uint64_t ticks = 0;
+            std::uint64_t max_ticks = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (const auto &counters : m_shards) {
+                    profile.calls += counters->calls.load(std::memory_order_relaxed);
+                    ticks += counters->ticks.load(std::memory_order_relaxed);
+                    max_ticks = (std::max)(max_ticks, counters->max_ticks.load(std::memory_order_relaxed));
+                    for (std::size_t i = 0; i < histogram_size; i++)
+                        buckets[i] += counters->buckets[i].load(std::memory_order_relaxed);
+                }
+            }
+            if (profile.calls == 0)
+                return profile;
+
+            const double period = tick_period();
+            profile.total_time = ticks_to_duration(ticks, period);
+            profile.max_time = ticks_to_duration(max_ticks, period);
+            std::size_t used = histogram_size;
+            while (used > 0 && buckets[used - 1] == 0)
+                used--;
+            for (std::size_t i = 0; i < used; i++)
+                profile.histogram.push_back({ticks_to_duration(std::uint64_t(1) << i, period), buckets[i]});
+            return profile;
+        }
+
+    private:
+        template<typename T>
+        friend class profiled_function;
+        friend class dylib;
+
+        static constexpr std::size_t histogram_size = 64;
+
+        struct shard {
+            std::atomic<std::uint64_t> calls{0};
+            std::atomic<std::uint64_t> ticks{0};
+            std::atomic<std::uint64_t> max_ticks{0};
+            std::atomic<std::uint64_t> buckets[histogram_size] = {};
+        };
+
+        struct shard_slot {
+            std::uint64_t profiler_id;
+            shard *counters;
+        };
+
+        /**
+         *  Times a call from its construction to its destruction, exceptions included
+         */
+        class scope {
+        public:
+            explicit scope(const call_profiler &profiler) noexcept : m_profiler(profiler), m_start(read_ticks()) {}
+
+            scope(const scope &) = delete;
+            scope& operator=(const scope &) = delete;
+
+            ~scope() {
+                m_profiler.record(read_ticks() - m_start);
+            }
+
+        private:
+            const call_profiler &m_profiler;
+            std::uint64_t m_start{0};
+        };
+
+        std::string m_symbol{};
+        std::uint64_t m_id{0};
+        mutable std::mutex m_mutex{};
+        mutable std::vector<std::unique_ptr<shard>> m_shards{};
+
+        explicit call_profiler(const char *symbol_name) : m_symbol(symbol_name), m_id(next_id()) {}
+
+        static std::uint64_t next_id() noexcept {
+            static std::atomic<std::uint64_t> id{0};
+            return id.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        void record(std::uint64_t ticks) const noexcept {
+            shard *counters = local_shard();
+            if (counters == nullptr)
+                return;
+            add(counters->calls, 1);
+            add(counters->ticks, ticks);
+            add(counters->buckets[bucket_of(ticks)], 1);
+            if (ticks > counters->max_ticks.load(std::memory_order_relaxed))
+                counters->max_ticks.store(ticks, std::memory_order_relaxed);
+        }
+
+        // only the owning thread writes a shard, a plain load and store is enough
+        static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value) noexcept {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        static std::size_t bucket_of(std::uint64_t ticks) noexcept {
+            if (ticks == 0)
+                return 0;
+#if defined(__GNUC__)
+            const std::size_t bits = 64 - static_cast<std::size_t>(__builtin_clzll(ticks));
+#else
+            std::size_t bits = 0;
+            for (std::uint64_t rest = ticks; rest != 0; rest >>= 1)
+                bits++;
+#endif
+            return (std::min)(bits, histogram_size - 1);
+        }
+
+        shard *local_shard() const noexcept {
+            static thread_local shard_slot last = {0, nullptr};
+            if (last.profiler_id == m_id)
+                return last.counters;
+
+            // profiler ids are never reused, the slots of destroyed profilers are never matched again
+            static thread_local std::vector<shard_slot> slots;
+            for (const auto &slot : slots) {
+                if (slot.profiler_id == m_id) {
+                    last = slot;
+                    return slot.counters;
+                }
+            }
+            try {
+                std::unique_ptr<shard> counters(new shard);
+                slots.reserve(slots.size() + 1);
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_shards.push_back(std::move(counters));
+                    last = {m_id, m_shards.back().get()};
+                }
+                slots.push_back(last);
+                return last.counters;
+            } catch (...) {
+                return nullptr;
+            }
+        }
+
+        static std::chrono::nanoseconds ticks_to_duration(std::uint64_t ticks, double period) noexcept {
+            return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(static_cast<double>(ticks) * period));
+        }
+    };
+
+    /**
+     *  A function handle that counts and times its calls in a call_profiler while profiling is
+     *  enabled, see set_profiling. When profiling is disabled a call costs one branch more than
+     *  calling the function pointer. The handle must not be used after the library has been closed
+     */
+    template<typename R, typename... Args>
+    class profiled_function<R(Args...)> {
+    public:
+        R operator()(Args... args) const {
+            if (!profiling_slot().load(std::memory_order_relaxed))
+                return m_function(std::forward<Args>(args)...);
+            const call_profiler::scope timed(*m_profiler);
+            return m_function(std::forward<Args>(args)...);
+        }
+
+        /**
+         *  @return a pointer to the function, calling it directly bypasses the profiler
+         */
+        R (*get() const noexcept)(Args...) {
+            return m_function;
+        }
+
+        /**
+         *  @return the profiler of the function, shared by every profiled handle of the same function
+         */
+        const call_profiler &profiler() const noexcept {
+            return *m_profiler;
+        }
+
+    private:
+        friend class dylib;
+
+        profiled_function(R (*function)(Args...), std::shared_ptr<call_profiler> profiler) noexcept
+            : m_function(function), m_profiler(std::move(profiler)) {}
+
+        R (*m_function)(Args...){nullptr};
+        std::shared_ptr<call_profiler> m_profiler{};
+    };
+
+    /**
+     *  An ordered list of directories where dynamic libraries are searched for, like LD_LIBRARY_PATH.
+     *  Candidates are checked with a cheap file existence test before being opened, and both the
+     *  hits and the misses are cached, so searching the same library again skips the scan
+     */
+    class search_path {
+    public:
+        search_path() = default;
+
+        /**
+         *  @param directories the directories to search, in order
+         */
+        explicit search_path(std::vector<std::string> directories) : m_directories(std::move(directories)) {}
+
+        search_path(const search_path &other) : m_directories(), m_cache() {
+            std::lock_guard<std::mutex> lock(other.m_mutex);
+            m_directories = other.m_directories;
+            m_cache = other.m_cache;
+        }
+
+        search_path& operator=(const search_path &other) {
+            if (this != &other) {
+                std::vector<std::string> directories;
+                std::unordered_map<std::string, std::string> cache;
+                {
+                    std::lock_guard<std::mutex> lock(other.m_mutex);
+                    directories = other.m_directories;
+                    cache = other.m_cache;
+                }
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_directories.swap(directories);
+                m_cache.swap(cache);
+            }
+            return *this;
+        }
+
+        /**
+         *  Create a search path from an environment variable holding a list of directories,
+         *  separated by ':' (';' on Windows). Empty entries stand for the current directory
+         *
+         *  @param variable the name of the environment variable
+         *
+         *  @return the search path, empty if the variable is not set
+         */
+        static search_path from_env(const char *variable = DYLIB_WIN_MAC_OTHER("PATH", "DYLD_LIBRARY_PATH", "LD_LIBRARY_PATH")) {
+            if (!variable)
+                throw std::invalid_argument("Null parameter");
+
+            std::vector<std::string> directories;
+            std::string value = get_env(variable);
+            if (value.empty())
+                return search_path(std::move(directories));
+
+            const char separator = DYLIB_WIN_OTHER(';', ':');
+            std::size_t begin = 0;
+            for (;;) {
+                const std::size_t end = value.find(separator, begin);
+                std::string directory = value.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+                directories.push_back(directory.empty() ? "." : std::move(directory));
+                if (end == std::string::npos)
+                    break;
+                begin = end + 1;
+            }
+            return search_path(std::move(directories));
+        }
+
+        /**
+         *  Append a directory to the search path, and clear the cache
+         *
+         *  @param directory the directory to search last
+         */
+        void add_directory(std::string directory) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_directories.push_back(std::move(directory));
+            m_cache.clear();
+        }
+
+        /**
+         *  @return the directories searched, in order
+         */
+        std::vector<std::string> directories() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_directories;
+        }
+
+        /**
+         *  Find a dynamic library in the directories of the search path
+         *
+         *  @param lib_name the name of the dynamic library to find
+         *  @param decorations add os decorations to the library name
+         *
+         *  @return the path of the first matching file, or an empty string if none was found
+         */
+        ///@{
+        std::string find(const char *lib_name, bool decorations = add_filename_decorations) const {
+            if (!lib_name)
+                throw std::invalid_argument("Null parameter");
+
+            const std::string file_name = library_path("", lib_name, decorations);
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto cached = m_cache.find(file_name);
+            if (cached != m_cache.end())
+                return cached->second;
+
+            std::string found;
+            for (auto &directory : m_directories) {
+                path_buffer path;
+                compose_path(path, directory.c_str(), directory.size(), file_name.c_str(), file_name.size(),
+                    no_filename_decorations);
+                if (is_file(path.c_str())) {
+                    found.assign(path.c_str(), path.size());
+                    break;
+                }
+            }
+            m_cache.emplace(file_name, found);
+            return found;
+        }
+
+        std::string find(const std::string &lib_name, bool decorations = add_filename_decorations) const {
+            return find(lib_name.c_str(), decorations);
+        }
+        ///@}
+
+        /**
+         *  Forget every cached search result, for instance after libraries were installed or removed
+         */
+        void clear_cache() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cache.clear();
+        }
+
+    private:
+        std::vector<std::string> m_directories{};
+        mutable std::unordered_map<std::string, std::string> m_cache{};
+        mutable std::mutex m_mutex{};
+
+        static bool is_file(const char *path) noexcept {
+#if (defined(_WIN32) || defined(_WIN64))
+            const DWORD attributes = GetFileAttributesA(path);
+            return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+            struct stat info;
+            return stat(path, &info) == 0 && S_ISREG(info.st_mode);
+#endif
+        }
+
+        static std::string get_env(const char *variable) {
+#if (defined(_WIN32) || defined(_WIN64))
+            const DWORD length = GetEnvironmentVariableA(variable, nullptr, 0);
+            if (length == 0)
+                return std::string();
+            std::string value(length, '\0');
+            value.resize(GetEnvironmentVariableA(variable, &value[0], length));
+            return value;
+#else
+            const char *value = std::getenv(variable);
+            return value ? std::string(value) : std::string();
+#endif
+        }
+    };
+
     dylib(const dylib&) = delete;
     dylib& operator=(const dylib&) = delete;
 
-    dylib(dylib &&other) noexcept : m_handle(other.m_handle) {
+    dylib(dylib &&other) noexcept
+        : m_handle(other.m_handle), m_symbol_cache(std::move(other.m_symbol_cache)), m_backing(std::move(other.m_backing)),
+          m_huge_page_bytes(other.m_huge_page_bytes), m_deferred_close(other.m_deferred_close) {
         other.m_handle = nullptr;
+        other.m_huge_page_bytes = 0;
+        other.m_deferred_close = false;
+        m_counters = std::move(other.m_counters);
     }
 
     dylib& operator=(dylib &&other) noexcept {
-        if (this != &other)
+        if (this != &other) {
             std::swap(m_handle, other.m_handle);
+            std::swap(m_symbol_cache, other.m_symbol_cache);
+            std::swap(m_backing, other.m_backing);
+            std::swap(m_huge_page_bytes, other.m_huge_page_bytes);
+            std::swap(m_deferred_close, other.m_deferred_close);
+            std::swap(m_counters, other.m_counters);
+        }
         return *this;
     }
 
@@ -115,177 +946,4648 @@ public:
      *  @param dir_path the directory path where is located the dynamic library you want to load
      *  @param name the name of the dynamic library to load
      *  @param decorations add os decorations to the library name
+     *  @param options the flags to load the dynamic library with
      */
     ///@{
-    dylib(const char *dir_path, const char *lib_name, bool decorations = add_filename_decorations) {
+    dylib(const char *dir_path, const char *lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults) {
         if (!dir_path || !lib_name)
             throw std::invalid_argument("Null parameter");
 
-        std::string final_name = lib_name;
-        std::string final_path = dir_path;
+        load_library(dir_path, std::strlen(dir_path), lib_name, std::strlen(lib_name), decorations, options);
+    }
+
+    dylib(const std::string &dir_path, const std::string &lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib(dir_path.c_str(), lib_name.c_str(), decorations, options) {}
 
-        if (decorations)
-            final_name = filename_components::prefix + final_name + filename_components::suffix;
+    dylib(const std::string &dir_path, const char *lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib(dir_path.c_str(), lib_name, decorations, options) {}
 
-        if (!final_path.empty() && final_path.find_last_of('/') != final_path.size() - 1)
-            final_path += '/';
+    dylib(const char *dir_path, const std::string &lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib(dir_path, lib_name.c_str(), decorations, options) {}
 
-        m_handle = open((final_path + final_name).c_str());
+    explicit dylib(const std::string &lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib("", lib_name.c_str(), decorations, options) {}
 
-        if (!m_handle)
-            throw load_error("Could not load library \"" + final_path + final_name + "\"\n" + get_error_description());
+    explicit dylib(const char *lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib("", lib_name, decorations, options) {}
+
+    /**
+     *  @brief Loads a dynamic library found in a search path
+     *
+     *  @throws dylib::load_error if the library could not be found in the search path or could not be opened
+     *
+     *  @param paths the search path to look the dynamic library up in
+     *  @param lib_name the name of the dynamic library to load
+     *  @param decorations add os decorations to the library name
+     *  @param options the flags to load the dynamic library with
+     */
+    ///@{
+    dylib(const search_path &paths, const char *lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults) {
+        const std::string lib_path = paths.find(lib_name, decorations);
+        if (lib_path.empty())
+            throw load_error("Could not find library \"" + library_path("", lib_name, decorations) + "\" in the search path");
+
+        load_library("", 0, lib_path.c_str(), lib_path.size(), no_filename_decorations, options);
     }
 
-    dylib(const std::string &dir_path, const std::string &lib_name, bool decorations = add_filename_decorations)
-        : dylib(dir_path.c_str(), lib_name.c_str(), decorations) {}
+    dylib(const search_path &paths, const std::string &lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib(paths, lib_name.c_str(), decorations, options) {}
+    ///@}
 
-    dylib(const std::string &dir_path, const char *lib_name, bool decorations = add_filename_decorations)
-        : dylib(dir_path.c_str(), lib_name, decorations) {}
+#ifdef DYLIB_CPP17
+    explicit dylib(const std::filesystem::path &lib_path, load_options options = load_options::defaults)
+        : dylib("", lib_path.string().c_str(), no_filename_decorations, options) {}
 
-    dylib(const char *dir_path, const std::string &lib_name, bool decorations = add_filename_decorations)
-        : dylib(dir_path, lib_name.c_str(), decorations) {}
+    dylib(const std::filesystem::path &dir_path, const std::string &lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib(dir_path.string().c_str(), lib_name.c_str(), decorations, options) {}
 
-    explicit dylib(const std::string &lib_name, bool decorations = add_filename_decorations)
-        : dylib("", lib_name.c_str(), decorations) {}
+    dylib(const std::filesystem::path &dir_path, const char *lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib(dir_path.string().c_str(), lib_name, decorations, options) {}
 
-    explicit dylib(const char *lib_name, bool decorations = add_filename_decorations)
-        : dylib("", lib_name, decorations) {}
+    dylib(std::string_view dir_path, std::string_view lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults) {
+        load_library(dir_path.data(), dir_path.size(), lib_name.data(), lib_name.size(), decorations, options);
+    }
 
-#ifdef DYLIB_CPP17
-    explicit dylib(const std::filesystem::path &lib_path)
-        : dylib("", lib_path.string().c_str(), no_filename_decorations) {}
+    dylib(std::string_view dir_path, const char *lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults) {
+        if (!lib_name)
+            throw std::invalid_argument("Null parameter");
 
-    dylib(const std::filesystem::path &dir_path, const std::string &lib_name, bool decorations = add_filename_decorations)
-        : dylib(dir_path.string().c_str(), lib_name.c_str(), decorations) {}
+        load_library(dir_path.data(), dir_path.size(), lib_name, std::strlen(lib_name), decorations, options);
+    }
 
-    dylib(const std::filesystem::path &dir_path, const char *lib_name, bool decorations = add_filename_decorations)
-        : dylib(dir_path.string().c_str(), lib_name, decorations) {}
+    dylib(std::string_view dir_path, const std::string &lib_name, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults)
+        : dylib(dir_path, std::string_view(lib_name), decorations, options) {}
 #endif
     ///@}
 
-    ~dylib() {
-        if (m_handle)
-            close(m_handle);
-    }
+    /**
+     *  A contiguous range of bytes holding the image of a dynamic library
+     */
+    struct memory_view {
+        /** the first byte of the image */
+        const void *data;
+        /** the size of the image in bytes */
+        std::size_t size;
+    };
 
     /**
-     *  Get a symbol from the dynamic library currently loaded in the object
-     * 
-     *  @throws dylib::symbol_error if the symbol could not be found
+     *  @brief Loads a dynamic library from an image held in memory
      *
-     *  @param symbol_name the symbol name to get from the dynamic library
+     *  On Linux, the image is written to an anonymous memory file (memfd_create) that is opened through
+     *  /proc/self/fd, so it never reaches a filesystem. Elsewhere, or if memory files are unavailable,
+     *  the image goes through a temporary file, removed as soon as the platform allows it
      *
-     *  @return a pointer to the requested symbol
+     *  @throws std::invalid_argument if the image data is null
+     *  @throws dylib::load_error if the image could not be written or opened
+     *
+     *  @param image the bytes of the dynamic library file, which can be released once the object is built
+     *  @param options the flags to load the dynamic library with
      */
-    native_symbol_type get_symbol(const char *symbol_name) const {
-        if (!symbol_name)
+    explicit dylib(const memory_view &image, load_options options = load_options::defaults) {
+        if (!image.data)
             throw std::invalid_argument("Null parameter");
-        if (!m_handle)
-            throw std::logic_error("The dynamic library handle is null");
 
-        auto symbol = locate_symbol(m_handle, symbol_name);
-
-        if (symbol == nullptr)
-            throw symbol_error("Could not get symbol \"" + std::string(symbol_name) + "\"\n" + get_error_description());
-        return symbol;
+        load_image(image, options);
     }
 
-    native_symbol_type get_symbol(const std::string &symbol_name) const {
-        return get_symbol(symbol_name.c_str());
-    }
+    /**
+     *  A library of a batch that could not be loaded, see load_all
+     */
+    struct load_failure {
+        /** the index of the library in the batch */
+        std::size_t index;
+        /** the path of the library */
+        std::string path;
+        /** the reason why the library could not be loaded */
+        load_error error;
+    };
 
     /**
-     *  Get a function from the dynamic library currently loaded in the object
-     * 
-     *  @throws dylib::symbol_error if the symbol could not be found
-     *
-     *  @param T the template argument must be the function prototype to get
-     *  @param symbol_name the symbol name of a function to get from the dynamic library
-     *
-     *  @return a pointer to the requested function
+     *  The outcome of a batch load, see load_all
      */
-    template<typename T>
-    T *get_function(const char *symbol_name) const {
-#if (defined(__GNUC__) && __GNUC__ >= 8)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-function-type"
-#endif
-        return reinterpret_cast<T *>(get_symbol(symbol_name));
-#if (defined(__GNUC__) && __GNUC__ >= 8)
-#pragma GCC diagnostic pop
-#endif
-    }
+    struct load_result {
+        /** the libraries in the order of the batch, the ones that failed to load hold a null handle */
+        std::vector<dylib> libraries;
+        /** the libraries that could not be loaded */
+        std::vector<load_failure> errors;
 
-    template<typename T>
-    T *get_function(const std::string &symbol_name) const {
-        return get_function<T>(symbol_name.c_str());
-    }
+        /**
+         *  @return true if every library of the batch was loaded, false otherwise
+         */
+        bool ok() const noexcept {
+            return errors.empty();
+        }
+    };
 
     /**
-     *  Get a variable from the dynamic library currently loaded in the object
-     * 
-     *  @throws dylib::symbol_error if the symbol could not be found
+     *  @brief Loads a batch of dynamic libraries concurrently
      *
-     *  @param T the template argument must be the type of the variable to get
-     *  @param symbol_name the symbol name of a variable to get from the dynamic library
+     *  The files are first prefetched all at once, then opened by a pool of threads.
+     *  A failure does not abort the batch, it is reported in the errors of the result
      *
-     *  @return a reference to the requested variable
+     *  @param paths the paths of the dynamic libraries to load, without added decorations
+     *  @param threads the number of loading threads, 0 to use one per hardware thread
+     *  @param order pairs of indexes {before, after} forcing the library "before" to be
+     *  loaded before the library "after", which fails if "before" could not be loaded
+     *  @param options the flags to load the dynamic libraries with
+     *
+     *  @return the loaded libraries and the loading errors
      */
-    template<typename T>
-    T &get_variable(const char *symbol_name) const {
-        return *reinterpret_cast<T *>(get_symbol(symbol_name));
-    }
+    static load_result load_all(const std::vector<std::string> &paths, unsigned threads = 0,
+        const std::vector<std::pair<std::size_t, std::size_t>> &order = {},
+        load_options options = load_options::defaults) {
+        for (auto &constraint : order)
+            if (constraint.first >= paths.size() || constraint.second >= paths.size())
+                throw std::invalid_argument("Load order index out of range");
 
-    template<typename T>
-    T &get_variable(const std::string &symbol_name) const {
-        return get_variable<T>(symbol_name.c_str());
+        for (auto &path : paths)
+            prefetch_file(path.c_str());
+
+        batch_loader batch(paths, order, options);
+        run_batch(batch, threads, paths.size());
+        return batch.result();
     }
 
     /**
-     *  Check if a symbol exists in the currently loaded dynamic library. 
-     *  This method will return false if no dynamic library is currently loaded 
-     *  or if the symbol name is nullptr
-     *
-     *  @param symbol_name the symbol name to look for
-     *
-     *  @return true if the symbol exists in the dynamic library, false otherwise
+     *  The dependency graph of a set of dynamic libraries, read from their files without loading them:
+     *  the DT_NEEDED entries of the ELF dynamic section, the import table of PE files or the dylib load
+     *  commands of Mach-O files. The dependencies already loaded in the process are not followed further.
+     *  preload opens the dependencies that are not loaded yet, in parallel and in dependency order,
+     *  so that loading the libraries afterwards finds them ready
      */
-    bool has_symbol(const char *symbol_name) const noexcept {
-        if (!m_handle || !symbol_name)
-            return false;
-        return locate_symbol(m_handle, symbol_name) != nullptr;
-    }
+    class dependency_graph {
+    public:
+        /**
+         *  A library of the graph
+         */
+        struct library {
+            /** the path of a root, or the name of a dependency as written in the library that needs it */
+            std::string name;
+            /** the path of the file, empty if it could not be found, the loader then searches the name itself */
+            std::string path;
+            /** the indexes of the libraries it needs */
+            std::vector<std::size_t> dependencies;
+            /** the number of roots that need it, directly or not */
+            std::size_t required_by;
+            /** true for the libraries the graph was built from */
+            bool root;
+            /** true if it was loaded in the process when the graph was built, or since by preload */
+            bool loaded;
+        };
 
-    bool has_symbol(const std::string &symbol) const noexcept {
+        /**
+         *  The outcome of dependency_graph::preload
+         */
+        struct preload_report {
+            /** the number of dependencies that were opened */
+            std::size_t preloaded;
+            /** the dependencies that could not be opened, indexed in dependency_graph::libraries */
+            std::vector<load_failure> errors;
+            /** the time spent in preload */
+            std::chrono::nanoseconds elapsed;
+            /** the part of elapsed spent in the calls advising the system to read the files ahead
+                (posix_fadvise), which only queue the reads: this is no time spent reading nor saved */
+            std::chrono::nanoseconds advise_time;
+        };
+
+        /**
+         *  Reads the dependency graph of some dynamic libraries
+         *
+         *  @throws dylib::load_error if a library could not be read
+         *
+         *  @param paths the paths of the dynamic libraries, without added decorations
+         */
+        explicit dependency_graph(const std::vector<std::string> &paths) {
+            for (const auto &path : paths) {
+                binary info;
+                if (!read_binary(path, info))
+                    throw load_error("Could not load library \"" + path + "\"\nUnreadable or unsupported file format");
+                const std::size_t index = add(path, path, loaded_path(path, nullptr));
+                m_libraries[index].root = true;
+            }
+            // the vector grows while the dependencies are read, each library being read once
+            for (std::size_t i = 0; i < m_libraries.size(); i++) {
+                binary info;
+                if (m_libraries[i].loaded || m_libraries[i].path.empty() || !read_binary(m_libraries[i].path, info))
+                    continue;
+                for (const auto &name : info.needed) {
+                    std::string found = find_dependency(name, info);
+                    std::string loaded;
+                    const bool is_loaded = loaded_path(found.empty() ? name : found, &loaded);
+                    if (is_loaded && !loaded.empty())
+                        found = loaded;
+                    const std::size_t dependency = add(name, found, is_loaded);
+                    if (dependency != i)
+                        m_libraries[i].dependencies.push_back(dependency);
+                }
+            }
+            count_required_by();
+        }
+
+        /**
+         *  @return the libraries of the graph, the roots first in the given order
+         */
+        const std::vector<library> &libraries() const noexcept {
+            return m_libraries;
+        }
+
+        /**
+         *  @return the indexes of the libraries of the graph, each one after its dependencies.
+         *  A circular dependency is broken at the library that closes the cycle
+         */
+        std::vector<std::size_t> load_order() const {
+            std::vector<std::size_t> order;
+            std::vector<char> state(m_libraries.size(), 0);
+            for (std::size_t i = 0; i < m_libraries.size(); i++)
+                visit(i, state, order);
+            return order;
+        }
+
+        /**
+         *  Open the dependencies of the graph that are not loaded and are not roots, in parallel and
+         *  each one after its own dependencies. They stay loaded as long as the graph exists
+         *
+         *  @param threads the number of loading threads, 0 to use one per hardware thread
+         *  @param options the flags to load the dependencies with
+         *
+         *  @return the number of preloaded dependencies, the failures and the time spent
+         */
+        preload_report preload(unsigned threads = 0, load_options options = load_options::defaults) {
+            const auto start = std::chrono::steady_clock::now();
+            preload_report report{0, std::vector<load_failure>(), std::chrono::nanoseconds(0), std::chrono::nanoseconds(0)};
+            std::chrono::steady_clock::duration advise_time(0);
+
+            std::vector<std::size_t> targets;
+            std::vector<std::size_t> position(m_libraries.size(), m_libraries.size());
+            for (auto index : load_order()) {
+                const library &lib = m_libraries[index];
+                if (!lib.path.empty() && !lib.loaded) {
+                    const auto advise_start = std::chrono::steady_clock::now();
+                    prefetch_file(lib.path.c_str());
+                    advise_time += std::chrono::steady_clock::now() - advise_start;
+                }
+                if (lib.root || lib.loaded)
+                    continue;
+                position[index] = targets.size();
+                targets.push_back(index);
+            }
+
+            std::vector<std::string> paths;
+            std::vector<std::pair<std::size_t, std::size_t>> order;
+            for (auto index : targets) {
+                paths.push_back(m_libraries[index].path.empty() ? m_libraries[index].name : m_libraries[index].path);
+                for (auto dependency : m_libraries[index].dependencies)
+                    if (position[dependency] != m_libraries.size())
+                        order.emplace_back(position[dependency], position[index]);
+            }
+
+            batch_loader batch(paths, order, options);
+            run_batch(batch, threads, paths.size());
+            load_result result = batch.result();
+            for (auto &failure : result.errors) {
+                failure.index = targets[failure.index];
+                report.errors.push_back(std::move(failure));
+            }
+            for (std::size_t i = 0; i < result.libraries.size(); i++) {
+                if (!result.libraries[i].native_handle())
+                    continue;
+                m_libraries[targets[i]].loaded = true;
+                m_preloaded.push_back(std::move(result.libraries[i]));
+                report.preloaded++;
+            }
+
+            report.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            report.advise_time = std::chrono::duration_cast<std::chrono::nanoseconds>(advise_time);
+            return report;
+        }
+
+    private:
+        struct binary {
+            /** the names of the needed libraries */
+            std::vector<std::string> needed{};
+            /** the directories searched first for the needed libraries */
+            std::vector<std::string> first_dirs{};
+            /** the directories searched after the environment */
+            std::vector<std::string> last_dirs{};
+        };
+
+        class file_reader {
+        public:
+            explicit file_reader(const std::string &path) {
+#if defined(_MSC_VER)
+                if (fopen_s(&m_file, path.c_str(), "rb") != 0)
+                    m_file = nullptr;
+#else
+                m_file = std::fopen(path.c_str(), "rb");
+#endif
+            }
+
+            file_reader(const file_reader &) = delete;
+            file_reader& operator=(const file_reader &) = delete;
+
+            ~file_reader() {
+                if (m_file)
+                    std::fclose(m_file);
+            }
+
+            explicit operator bool() const noexcept {
+                return m_file != nullptr;
+            }
+
+            bool read(std::uint64_t offset, void *data, std::size_t size) noexcept {
+                return m_file && offset <= static_cast<std::uint64_t>((std::numeric_limits<long>::max)())
+                    && std::fseek(m_file, static_cast<long>(offset), SEEK_SET) == 0
+                    && std::fread(data, 1, size, m_file) == size;
+            }
+
+            std::string read_string(std::uint64_t offset) {
+                std::string value;
+                char chunk[256];
+                while (value.size() < 4096) {
+                    std::size_t length = 0;
+                    if (m_file && std::fseek(m_file, static_cast<long>(offset + value.size()), SEEK_SET) == 0)
+                        length = std::fread(chunk, 1, sizeof(chunk), m_file);
+                    if (length == 0)
+                        break;
+                    const std::size_t end = static_cast<std::size_t>(std::find(chunk, chunk + length, '\0') - chunk);
+                    value.append(chunk, end);
+                    if (end != length)
+                        break;
+                }
+                return value;
+            }
+
+        private:
+            std::FILE *m_file{nullptr};
+        };
+
+        std::vector<library> m_libraries{};
+        std::unordered_map<std::string, std::size_t> m_indexes{};
+        std::vector<dylib> m_preloaded{};
+
+        std::size_t add(const std::string &name, const std::string &path, bool loaded) {
+            const auto found = m_indexes.find(path.empty() ? name : path);
+            if (found != m_indexes.end())
+                return found->second;
+            m_indexes[path.empty() ? name : path] = m_libraries.size();
+            m_libraries.push_back(library{name, path, std::vector<std::size_t>(), 0, false, loaded});
+            return m_libraries.size() - 1;
+        }
+
+        void visit(std::size_t index, std::vector<char> &state, std::vector<std::size_t> &order) const {
+            if (state[index] != 0)
+                return;
+            state[index] = 1;
+            for (auto dependency : m_libraries[index].dependencies)
+                visit(dependency, state, order);
+            state[index] = 2;
+            order.push_back(index);
+        }
+
+        void count_required_by() {
+            std::vector<std::size_t> stack;
+            for (std::size_t root = 0; root < m_libraries.size(); root++) {
+                if (!m_libraries[root].root)
+                    continue;
+                std::vector<bool> seen(m_libraries.size(), false);
+                seen[root] = true;
+                stack.push_back(root);
+                while (!stack.empty()) {
+                    const std::size_t index = stack.back();
+                    stack.pop_back();
+                    for (auto dependency : m_libraries[index].dependencies) {
+                        if (seen[dependency])
+                            continue;
+                        seen[dependency] = true;
+                        m_libraries[dependency].required_by++;
+                        stack.push_back(dependency);
+                    }
+                }
+            }
+        }
+
+        static std::string directory_of(const std::string &path) {
+            const std::size_t separator = path.find_last_of(DYLIB_WIN_OTHER("/\\", "/"));
+            return separator == std::string::npos ? std::string(".") : path.substr(0, separator == 0 ? 1 : separator);
+        }
+
+        static bool is_readable(const std::string &path) {
+            return static_cast<bool>(file_reader(path));
+        }
+
+        static std::string join(const std::string &dir, const std::string &name) {
+            return dir.empty() || dir.back() == '/' ? dir + name : dir + "/" + name;
+        }
+
+#if (defined(_WIN32) || defined(_WIN64))
+        static bool read_binary(const std::string &path, binary &info) {
+            file_reader file(path);
+            IMAGE_DOS_HEADER dos;
+            IMAGE_NT_HEADERS nt;
+            if (!file.read(0, &dos, sizeof(dos)) || dos.e_magic != IMAGE_DOS_SIGNATURE
+                || !file.read(static_cast<std::uint64_t>(dos.e_lfanew), &nt, sizeof(nt))
+                || nt.Signature != IMAGE_NT_SIGNATURE || nt.OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR_MAGIC)
+                return false;
+
+            std::vector<IMAGE_SECTION_HEADER> sections(nt.FileHeader.NumberOfSections);
+            const std::uint64_t sections_offset = static_cast<std::uint64_t>(dos.e_lfanew)
+                + offsetof(IMAGE_NT_HEADERS, OptionalHeader) + nt.FileHeader.SizeOfOptionalHeader;
+            if (!file.read(sections_offset, sections.data(), sections.size() * sizeof(IMAGE_SECTION_HEADER)))
+                return false;
+            auto file_offset = [&sections](DWORD rva) -> std::uint64_t {
+                for (const auto &section : sections)
+                    if (rva >= section.VirtualAddress && rva - section.VirtualAddress < section.SizeOfRawData)
+                        return static_cast<std::uint64_t>(rva) - section.VirtualAddress + section.PointerToRawData;
+                return 0;
+            };
+
+            info.first_dirs.push_back(directory_of(path));
+            char executable[MAX_PATH];
+            const DWORD length = GetModuleFileNameA(nullptr, executable, MAX_PATH);
+            if (length != 0 && length < MAX_PATH)
+                info.first_dirs.push_back(directory_of(std::string(executable, length)));
+
+            if (nt.OptionalHeader.NumberOfRvaAndSizes <= IMAGE_DIRECTORY_ENTRY_IMPORT)
+                return true;
+            const IMAGE_DATA_DIRECTORY &imports = nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+            std::uint64_t offset = imports.VirtualAddress ? file_offset(imports.VirtualAddress) : 0;
+            IMAGE_IMPORT_DESCRIPTOR descriptor;
+            while (offset != 0 && file.read(offset, &descriptor, sizeof(descriptor)) && descriptor.Name != 0) {
+                const std::uint64_t name = file_offset(descriptor.Name);
+                if (name != 0)
+                    info.needed.push_back(file.read_string(name));
+                offset += sizeof(descriptor);
+            }
+            return true;
+        }
+
+        static std::string find_dependency(const std::string &name, const binary &info) {
+            for (const auto &dir : info.first_dirs) {
+                const std::string candidate = dir + "\\" + name;
+                if (is_readable(candidate))
+                    return candidate;
+            }
+            return std::string();
+        }
+
+        static bool loaded_path(const std::string &name, std::string *path) {
+            HMODULE module = GetModuleHandleA(name.c_str());
+            if (!module)
+                return false;
+            char file_name[MAX_PATH];
+            const DWORD length = GetModuleFileNameA(module, file_name, MAX_PATH);
+            if (path && length != 0 && length < MAX_PATH)
+                path->assign(file_name, length);
+            return true;
+        }
+#else
+        static bool loaded_path(const std::string &name, std::string *path) {
+            void *handle = dlopen(name.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+            if (!handle)
+                return false;
+#if !defined(__APPLE__)
+            struct link_map *map = nullptr;
+            if (path && dlinfo(handle, RTLD_DI_LINKMAP, &map) == 0 && map && map->l_name && map->l_name[0])
+                *path = map->l_name;
+#else
+            static_cast<void>(path);
+#endif
+            dlclose(handle);
+            return true;
+        }
+
+#if defined(__APPLE__)
+        static std::uint32_t big_endian(std::uint32_t value) noexcept {
+            const auto bytes = reinterpret_cast<const unsigned char *>(&value);
+            return (static_cast<std::uint32_t>(bytes[0]) << 24) | (static_cast<std::uint32_t>(bytes[1]) << 16)
+                | (static_cast<std::uint32_t>(bytes[2]) << 8) | bytes[3];
+        }
+
+        static std::string executable_dir() {
+            char buffer[PATH_MAX];
+            std::uint32_t size = sizeof(buffer);
+            return _NSGetExecutablePath(buffer, &size) == 0 ? directory_of(buffer) : std::string(".");
+        }
+
+        static std::string expand_loader_path(const std::string &path, const std::string &loader_dir) {
+            if (path.compare(0, 13, "@loader_path/") == 0)
+                return join(loader_dir, path.substr(13));
+            if (path.compare(0, 17, "@executable_path/") == 0)
+                return join(executable_dir(), path.substr(17));
+            return path;
+        }
+
+        static bool read_binary(const std::string &path, binary &info) {
+            file_reader file(path);
+            std::uint32_t magic = 0;
+            std::uint64_t base = 0;
+            if (!file.read(0, &magic, sizeof(magic)))
+                return false;
+            if (big_endian(magic) == macho::fat_magic) {
+                const std::int32_t native = reinterpret_cast<const macho::header_64 *>(_dyld_get_image_header(0))->cputype;
+                macho::fat_header fat;
+                if (!file.read(0, &fat, sizeof(fat)))
+                    return false;
+                bool found = false;
+                for (std::uint32_t i = 0; !found && i < big_endian(fat.nfat_arch); i++) {
+                    macho::fat_arch arch;
+                    if (!file.read(sizeof(fat) + i * sizeof(arch), &arch, sizeof(arch)))
+                        return false;
+                    found = static_cast<std::int32_t>(big_endian(static_cast<std::uint32_t>(arch.cputype))) == native;
+                    base = big_endian(arch.offset);
+                }
+                if (!found)
+                    return false;
+            }
+
+            macho::header_64 header;
+            if (!file.read(base, &header, sizeof(header)) || header.magic != macho::magic_64)
+                return false;
+            std::vector<char> commands(header.sizeofcmds);
+            if (!file.read(base + sizeof(header), commands.data(), commands.size()))
+                return false;
+
+            const std::string loader_dir = directory_of(path);
+            std::size_t offset = 0;
+            for (std::uint32_t i = 0; i < header.ncmds && offset + sizeof(macho::load_command) <= commands.size(); i++) {
+                macho::load_command command;
+                std::memcpy(&command, commands.data() + offset, sizeof(command));
+                if (command.cmdsize < sizeof(command) || offset + command.cmdsize > commands.size())
+                    return false;
+                // both commands start with the offset of their string, which is nul terminated within the command
+                std::uint32_t name = 0;
+                if (command.cmdsize > sizeof(command) + sizeof(name))
+                    std::memcpy(&name, commands.data() + offset + sizeof(command), sizeof(name));
+                const char *text = name < command.cmdsize ? commands.data() + offset + name : nullptr;
+                const std::size_t text_size = text ? strnlen(text, command.cmdsize - name) : 0;
+                if (text && text_size < command.cmdsize - name) {
+                    if (command.cmd == macho::lc_load_dylib || command.cmd == macho::lc_load_weak_dylib
+                        || command.cmd == macho::lc_reexport_dylib || command.cmd == macho::lc_load_upward_dylib)
+                        info.needed.emplace_back(text, text_size);
+                    else if (command.cmd == macho::lc_rpath)
+                        info.first_dirs.push_back(expand_loader_path(std::string(text, text_size), loader_dir));
+                }
+                offset += command.cmdsize;
+            }
+            info.last_dirs.push_back(loader_dir);
+            return true;
+        }
+
+        static std::string find_dependency(const std::string &name, const binary &info) {
+            const std::string loader_dir = info.last_dirs.empty() ? std::string(".") : info.last_dirs.front();
+            if (name.compare(0, 7, "@rpath/") == 0) {
+                for (const auto &dir : info.first_dirs) {
+                    const std::string candidate = join(dir, name.substr(7));
+                    if (is_readable(candidate))
+                        return candidate;
+                }
+                return std::string();
+            }
+            // the system libraries live in the shared cache of dyld, not as files
+            const std::string candidate = expand_loader_path(name, loader_dir);
+            return is_readable(candidate) ? candidate : std::string();
+        }
+#else
+        struct native_image {
+            unsigned char elf_class;
+            ElfW(Half) machine;
+            std::vector<std::string> default_dirs;
+        };
+
+        static const native_image &native() {
+            static const native_image image = inspect_native_image();
+            return image;
+        }
+
+        static native_image inspect_native_image() {
+            native_image image{sizeof(void *) == 8 ? ELFCLASS64 : ELFCLASS32, EM_NONE, std::vector<std::string>()};
+            // the directory the C library was loaded from is one of the default directories of the loader
+            Dl_info info;
+            if (dladdr(reinterpret_cast<void *>(&std::fclose), &info) != 0 && info.dli_fbase != nullptr) {
+                image.machine = static_cast<const ElfW(Ehdr) *>(info.dli_fbase)->e_machine;
+                if (info.dli_fname && std::strchr(info.dli_fname, '/'))
+                    image.default_dirs.push_back(directory_of(info.dli_fname));
+            }
+            if (sizeof(void *) == 8) {
+                image.default_dirs.push_back("/lib64");
+                image.default_dirs.push_back("/usr/lib64");
+            }
+            image.default_dirs.push_back("/lib");
+            image.default_dirs.push_back("/usr/lib");
+            return image;
+        }
+
+        static bool read_header(file_reader &file, ElfW(Ehdr) &header) {
+            return file.read(0, &header, sizeof(header)) && std::memcmp(header.e_ident, ELFMAG, SELFMAG) == 0
+                && header.e_ident[EI_CLASS] == native().elf_class && header.e_phentsize == sizeof(ElfW(Phdr))
+                && (native().machine == EM_NONE || header.e_machine == native().machine);
+        }
+
+        static void split_dirs(const std::string &list, const std::string &origin, std::vector<std::string> &dirs) {
+            std::size_t start = 0;
+            while (start <= list.size()) {
+                std::size_t end = list.find(':', start);
+                if (end == std::string::npos)
+                    end = list.size();
+                std::string dir = list.substr(start, end - start);
+                for (const char *variable : {"${ORIGIN}", "$ORIGIN"}) {
+                    for (std::size_t found = dir.find(variable); found != std::string::npos; found = dir.find(variable))
+                        dir.replace(found, std::strlen(variable), origin);
+                }
+                if (!dir.empty())
+                    dirs.push_back(dir);
+                start = end + 1;
+            }
+        }
+
+        static bool read_binary(const std::string &path, binary &info) {
+            file_reader file(path);
+            ElfW(Ehdr) header;
+            if (!read_header(file, header))
+                return false;
+            std::vector<ElfW(Phdr)> segments(header.e_phnum);
+            if (!file.read(header.e_phoff, segments.data(), segments.size() * sizeof(ElfW(Phdr))))
+                return false;
+
+            const ElfW(Phdr) *dynamic = nullptr;
+            for (const auto &segment : segments)
+                if (segment.p_type == PT_DYNAMIC)
+                    dynamic = &segment;
+            if (dynamic == nullptr)
+                return true;
+            std::vector<ElfW(Dyn)> entries(dynamic->p_filesz / sizeof(ElfW(Dyn)));
+            if (!file.read(dynamic->p_offset, entries.data(), entries.size() * sizeof(ElfW(Dyn))))
+                return false;
+
+            std::uint64_t strings_address = 0;
+            std::uint64_t strings_size = 0;
+            std::vector<std::uint64_t> needed;
+            std::uint64_t rpath = 0;
+            std::uint64_t runpath = 0;
+            bool has_rpath = false;
+            bool has_runpath = false;
+            for (const auto &entry : entries) {
+                if (entry.d_tag == DT_NULL)
+                    break;
+                if (entry.d_tag == DT_NEEDED)
+                    needed.push_back(entry.d_un.d_val);
+                else if (entry.d_tag == DT_STRTAB)
+                    strings_address = entry.d_un.d_ptr;
+                else if (entry.d_tag == DT_STRSZ)
+                    strings_size = entry.d_un.d_val;
+                else if (entry.d_tag == DT_RPATH) {
+                    has_rpath = true;
+                    rpath = entry.d_un.d_val;
+                } else if (entry.d_tag == DT_RUNPATH) {
+                    has_runpath = true;
+                    runpath = entry.d_un.d_val;
+                }
+            }
+
+            // the string table is referenced by its address, found back in the file through the loaded segments
+            std::uint64_t strings_offset = 0;
+            bool mapped = false;
+            for (const auto &segment : segments) {
+                if (segment.p_type == PT_LOAD && strings_address >= segment.p_vaddr
+                    && strings_address + strings_size <= segment.p_vaddr + segment.p_filesz) {
+                    strings_offset = strings_address - segment.p_vaddr + segment.p_offset;
+                    mapped = true;
+                    break;
+                }
+            }
+            std::vector<char> strings(static_cast<std::size_t>(strings_size) + 1, '\0');
+            if (!mapped || !file.read(strings_offset, strings.data(), static_cast<std::size_t>(strings_size)))
+                return false;
+            auto string_at = [&strings](std::uint64_t offset) {
+                return offset < strings.size() ? std::string(strings.data() + offset) : std::string();
+            };
+
+            const std::string origin = directory_of(path);
+            if (has_rpath && !has_runpath)
+                split_dirs(string_at(rpath), origin, info.first_dirs);
+            if (has_runpath)
+                split_dirs(string_at(runpath), origin, info.last_dirs);
+            for (auto offset : needed) {
+                std::string name = string_at(offset);
+                if (!name.empty())
+                    info.needed.push_back(std::move(name));
+            }
+            return true;
+        }
+
+        static bool is_candidate(const std::string &path) {
+            file_reader file(path);
+            ElfW(Ehdr) header;
+            return read_header(file, header);
+        }
+
+        static std::string find_dependency(const std::string &name, const binary &info) {
+            if (name.find('/') != std::string::npos)
+                return is_readable(name) ? name : std::string();
+
+            std::vector<std::string> dirs = info.first_dirs;
+            const char *library_path = std::getenv("LD_LIBRARY_PATH");
+            if (library_path)
+                split_dirs(library_path, ".", dirs);
+            dirs.insert(dirs.end(), info.last_dirs.begin(), info.last_dirs.end());
+            dirs.insert(dirs.end(), native().default_dirs.begin(), native().default_dirs.end());
+            for (const auto &dir : dirs) {
+                const std::string candidate = join(dir, name);
+                if (is_candidate(candidate))
+                    return candidate;
+            }
+            return std::string();
+        }
+#endif
+#endif
+    };
+
+    /**
+     *  @brief Loads a dynamic library on a background thread
+     *
+     *  The library is opened like the constructor does, then the given symbols are resolved
+     *  into its symbol cache (see preload_symbols), so the library is ready to use once handed back.
+     *  The first overload returns a future holding the library or the load_error / symbol_error raised,
+     *  the second one invokes a callback on the background thread with the library, or with a null
+     *  library and the exception raised. The callback overload queues the loads on a single thread,
+     *  which runs them in call order and is joined at exit once they are done. An exception thrown by
+     *  the callback is ignored, and the callback must not wait for another queued load
+     *
+     *  @param on_loaded the callback to invoke once the library is loaded or failed to load
+     *  @param dir_path the directory path where is located the dynamic library you want to load
+     *  @param lib_name the name of the dynamic library to load
+     *  @param symbols the symbol names to resolve before handing the library back
+     *  @param decorations add os decorations to the library name
+     *  @param options the flags to load the dynamic library with
+     */
+    ///@{
+    static std::future<dylib> load_async(const std::string &dir_path, const std::string &lib_name,
+        const std::vector<std::string> &symbols = {}, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults) {
+        return std::async(std::launch::async, [=]() {
+            return load_and_preload(dir_path, lib_name, symbols, decorations, options);
+        });
+    }
+
+    static void load_async(std::function<void(dylib, std::exception_ptr)> on_loaded,
+        const std::string &dir_path, const std::string &lib_name, const std::vector<std::string> &symbols = {},
+        bool decorations = add_filename_decorations, load_options options = load_options::defaults) {
+        if (!on_loaded)
+            throw std::invalid_argument("Null parameter");
+        std::function<void()> job = [=]() {
+            dylib lib;
+            std::exception_ptr error;
+            try {
+                lib = load_and_preload(dir_path, lib_name, symbols, decorations, options);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            try {
+                on_loaded(std::move(lib), error);
+            } catch (...) {}  // nowhere to report it on the background thread
+        };
+        if (!async_loader::push(job))
+            job();  // during static destruction
+    }
+    ///@}
+
+    /**
+     *  Instruction set extensions a library variant can require, see load_variant.
+     *  They can be combined with operator|
+     */
+    enum class cpu_features : unsigned {
+        /** no extension, for the baseline variant */
+        none = 0,
+        /** SSE 4.2 (x86) */
+        sse4_2 = 1u << 0,
+        /** AVX (x86) */
+        avx = 1u << 1,
+        /** AVX2 (x86) */
+        avx2 = 1u << 2,
+        /** FMA3 (x86) */
+        fma = 1u << 3,
+        /** AVX-512 Foundation (x86) */
+        avx512f = 1u << 4,
+        /** AVX-512 Byte and Word (x86) */
+        avx512bw = 1u << 5,
+        /** AVX-512 Vector Length (x86) */
+        avx512vl = 1u << 6,
+        /** Advanced SIMD (ARM64) */
+        neon = 1u << 7,
+        /** Scalable Vector Extension (ARM64) */
+        sve = 1u << 8,
+    };
+
+    friend constexpr cpu_features operator|(cpu_features lhs, cpu_features rhs) noexcept {
+        return static_cast<cpu_features>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+    }
+
+    friend constexpr cpu_features operator&(cpu_features lhs, cpu_features rhs) noexcept {
+        return static_cast<cpu_features>(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+    }
+
+    /**
+     *  A build of a library for a set of instruction set extensions, see load_variant
+     */
+    struct variant {
+        /** appended to the base name of the library, e.g. "_avx2" to load "kernel_avx2" */
+        std::string suffix;
+        /** the extensions the processor must support to run this build */
+        cpu_features requirements;
+    };
+
+    /**
+     *  Detect the instruction set extensions supported by the processor and the operating system.
+     *  The detection runs once, on the first call
+     *
+     *  @return the supported extensions
+     */
+    static cpu_features detected_cpu_features() noexcept {
+        static const cpu_features features = detect_cpu_features();
+        return features;
+    }
+
+    /**
+     *  @brief Loads the best build of a library the processor can run
+     *
+     *  The variants are tried in order, so they must be listed from the most to the least
+     *  demanding one. The variants whose requirements are not all supported are skipped, and
+     *  so are the ones that fail to load, until one loads. The library name of each variant is
+     *  the base name followed by its suffix, decorated like the constructor does
+     *
+     *  @code
+     *  dylib kernel = dylib::load_variant("./plugins", "kernel", {
+     *      {"_avx512", dylib::cpu_features::avx512f | dylib::cpu_features::avx512bw},
+     *      {"_avx2", dylib::cpu_features::avx2 | dylib::cpu_features::fma},
+     *      {"_sse42", dylib::cpu_features::sse4_2},
+     *      {"", dylib::cpu_features::none},
+     *  });
+     *  @endcode
+     *
+     *  @throws std::invalid_argument if there is no variant
+     *  @throws dylib::load_error if no variant could be loaded, listing why each one was rejected
+     *
+     *  @param dir_path the directory path where are located the variants
+     *  @param base_name the name of the library without the variant suffix
+     *  @param variants the builds of the library, from the most to the least demanding one
+     *  @param decorations add os decorations to the library names
+     *  @param options the flags to load the dynamic library with
+     *
+     *  @return the loaded variant
+     */
+    static dylib load_variant(const std::string &dir_path, const std::string &base_name,
+        const std::vector<variant> &variants, bool decorations = add_filename_decorations,
+        load_options options = load_options::defaults) {
+        if (variants.empty())
+            throw std::invalid_argument("No library variant");
+
+        const cpu_features supported = detected_cpu_features();
+        std::string rejected;
+        for (auto &candidate : variants) {
+            const std::string lib_name = base_name + candidate.suffix;
+            if ((candidate.requirements & supported) != candidate.requirements) {
+                rejected += "\n\"" + library_path("", lib_name.c_str(), decorations) + "\": unsupported processor features";
+                continue;
+            }
+            try {
+                return dylib(dir_path, lib_name, decorations, options);
+            } catch (const load_error &error) {
+                rejected += std::string("\n") + error.what();
+            }
+        }
+        throw load_error("Could not load any variant of library \"" + base_name + "\"" + rejected);
+    }
+
+    ~dylib() {
+        if (!m_handle)
+            return;
+        // the backing of a library loaded from memory must outlive its handle
+        if (m_deferred_close && !m_backing && reaper::push(m_handle))
+            return;
+        close_observed(m_handle);
+    }
+
+    /**
+     *  Set the grace period of the libraries loaded with load_options::deferred_close: once
+     *  destroyed, they stay loaded for this delay before being closed, in batches, by a
+     *  background thread. The delay applies to the libraries destroyed afterwards
+     *
+     *  @param delay the time to wait before closing a destroyed library
+     */
+    static void set_close_delay(std::chrono::milliseconds delay) {
+        reaper::instance().set_delay(delay);
+    }
+
+    /**
+     *  Close every library waiting for a deferred close right away, and wait until they are closed
+     */
+    static void flush_closes() {
+        reaper::instance().flush();
+    }
+
+    /**
+     *  @return the number of destroyed libraries waiting for a deferred close
+     */
+    static std::size_t pending_closes() {
+        return reaper::instance().pending();
+    }
+
+    /**
+     *  A symbol name bundled with its length and hash, built at compile time by DYLIB_SYMBOL,
+     *  so that a cached lookup costs a single probe of the symbol cache with no strlen nor hashing
+     */
+    class symbol_key {
+    public:
+        /**
+         *  Builds the key of a name hashed by hash_of, to be used through DYLIB_SYMBOL which computes
+         *  the hash at compile time: the hash is not checked against the name
+         */
+        template<std::uint64_t Hash, std::size_t N>
+        static constexpr symbol_key precomputed(const char (&name)[N]) noexcept {
+            return symbol_key(name, length_of(name, N - 1), Hash);
+        }
+
+        /**
+         *  @return the FNV-1a hash of a string literal, as used by the symbol cache, up to its first null character
+         */
+        template<std::size_t N>
+        static constexpr std::uint64_t hash_of(const char (&name)[N]) noexcept {
+            return hash_of(name, length_of(name, N - 1), 14695981039346656037ULL);
+        }
+
+        constexpr const char *name() const noexcept {
+            return m_name;
+        }
+
+        constexpr std::size_t size() const noexcept {
+            return m_size;
+        }
+
+        constexpr std::uint64_t hash() const noexcept {
+            return m_hash;
+        }
+
+    private:
+        const char *m_name;
+        std::size_t m_size;
+        std::uint64_t m_hash;
+
+        constexpr symbol_key(const char *name, std::size_t size, std::uint64_t hash) noexcept
+            : m_name(name), m_size(size), m_hash(hash) {}
+
+        // the name can be an array larger than the string it holds
+        static constexpr std::size_t length_of(const char *name, std::size_t max) noexcept {
+            return max == 0 || *name == '\0' ? 0 : 1 + length_of(name + 1, max - 1);
+        }
+
+        static constexpr std::uint64_t hash_of(const char *name, std::size_t size, std::uint64_t hash) noexcept {
+            return size == 0 ? hash
+                             : hash_of(name + 1, size - 1, (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ULL);
+        }
+    };
+
+    /**
+     *  Get a symbol from the dynamic library currently loaded in the object
+     * 
+     *  @throws dylib::symbol_error if the symbol could not be found
+     *
+     *  @param symbol_name the symbol name to get from the dynamic library
+     *
+     *  @return a pointer to the requested symbol
+     */
+    native_symbol_type get_symbol(const char *symbol_name) const {
+        if (!symbol_name)
+            throw std::invalid_argument("Null parameter");
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+
+        auto symbol = resolve_symbol(symbol_name);
+
+        if (symbol == nullptr)
+            throw symbol_error("Could not get symbol \"" + std::string(symbol_name) + "\"\n" + lookup_error_description());
+        return symbol;
+    }
+
+    native_symbol_type get_symbol(const std::string &symbol_name) const {
+        return get_symbol(symbol_name.c_str());
+    }
+
+    /**
+     *  Get a symbol from the dynamic library currently loaded in the object, using the precomputed
+     *  hash of the key to probe the symbol cache, see DYLIB_SYMBOL
+     *
+     *  @throws std::logic_error if the dynamic library handle is null
+     *  @throws dylib::symbol_error if the symbol could not be found
+     *
+     *  @param key the symbol name and its hash
+     *
+     *  @return a pointer to the requested symbol
+     */
+    native_symbol_type get_symbol(const symbol_key &key) const {
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+
+        auto symbol = resolve_symbol(key.name(), nullptr, &key);
+
+        if (symbol == nullptr)
+            throw symbol_error("Could not get symbol \"" + std::string(key.name()) + "\"\n" + lookup_error_description());
+        return symbol;
+    }
+
+    /**
+     *  Get a given version of a symbol from the dynamic library currently loaded in the object (dlvsym).
+     *  Symbol versions only exist with the GNU C library, elsewhere the lookup always fails.
+     *  Versioned symbols go through the symbol cache like the other ones
+     *
+     *  @throws std::invalid_argument if the symbol name or the version is null
+     *  @throws std::logic_error if the dynamic library handle is null
+     *  @throws dylib::symbol_error if the symbol could not be found in this version
+     *
+     *  @param symbol_name the symbol name to get from the dynamic library
+     *  @param version the version of the symbol, as named in the version script of the library
+     *
+     *  @return a pointer to the requested symbol
+     */
+    ///@{
+    native_symbol_type get_symbol(const char *symbol_name, const char *version) const {
+        if (!symbol_name || !version)
+            throw std::invalid_argument("Null parameter");
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+
+        auto symbol = resolve_symbol(symbol_name, version);
+
+        if (symbol == nullptr)
+            throw symbol_error("Could not get symbol \"" + std::string(symbol_name) + "@" + version + "\"\n" +
+                versioned_error_description());
+        return symbol;
+    }
+
+    native_symbol_type get_symbol(const std::string &symbol_name, const std::string &version) const {
+        return get_symbol(symbol_name.c_str(), version.c_str());
+    }
+    ///@}
+
+    /**
+     *  Get a symbol, a function or a variable from the dynamic library currently loaded in the object,
+     *  without throwing nor allocating, even when the symbol is not found. The symbol is looked up once,
+     *  the error message being only built if requested from the result
+     *
+     *  @param T the function prototype or the variable type to get
+     *  @param symbol_name the symbol name to get from the dynamic library
+     *
+     *  @return the requested pointer, or the reason why it could not be found
+     */
+    ///@{
+    symbol_result<native_symbol_type> try_get_symbol(const char *symbol_name) const noexcept {
+        if (!symbol_name)
+            return symbol_result<native_symbol_type>(nullptr, symbol_errc::null_name);
+        if (!m_handle)
+            return symbol_result<native_symbol_type>(nullptr, symbol_errc::null_handle);
+
+        auto symbol = resolve_symbol(symbol_name);
+        if (!symbol)
+            return symbol_result<native_symbol_type>(symbol_errc::not_found, symbol_name, lookup_error());
+        return symbol_result<native_symbol_type>(symbol, symbol_errc::none);
+    }
+
+    symbol_result<native_symbol_type> try_get_symbol(const std::string &symbol_name) const noexcept {
+        return try_get_symbol(symbol_name.c_str());
+    }
+
+    template<typename T>
+    symbol_result<T *> try_get_function(const char *symbol_name) const noexcept {
+        auto symbol = try_get_symbol(symbol_name);
+        return symbol_result<T *>(function_cast<T>(symbol.m_value), symbol);
+    }
+
+    template<typename T>
+    symbol_result<T *> try_get_function(const std::string &symbol_name) const noexcept {
+        return try_get_function<T>(symbol_name.c_str());
+    }
+
+    template<typename T>
+    symbol_result<T *> try_get_variable(const char *symbol_name) const noexcept {
+        auto symbol = try_get_symbol(symbol_name);
+        return symbol_result<T *>(reinterpret_cast<T *>(symbol.m_value), symbol);
+    }
+
+    template<typename T>
+    symbol_result<T *> try_get_variable(const std::string &symbol_name) const noexcept {
+        return try_get_variable<T>(symbol_name.c_str());
+    }
+    ///@}
+
+    /**
+     *  Get a function from the dynamic library currently loaded in the object
+     * 
+     *  @throws dylib::symbol_error if the symbol could not be found
+     *
+     *  @param T the template argument must be the function prototype to get
+     *  @param symbol_name the symbol name of a function to get from the dynamic library
+     *
+     *  @return a pointer to the requested function
+     */
+    template<typename T>
+    T *get_function(const char *symbol_name) const {
+        return function_cast<T>(get_symbol(symbol_name));
+    }
+
+    template<typename T>
+    T *get_function(const std::string &symbol_name) const {
+        return get_function<T>(symbol_name.c_str());
+    }
+
+    template<typename T>
+    T *get_function(const symbol_key &key) const {
+        return function_cast<T>(get_symbol(key));
+    }
+
+    /**
+     *  Get a given version of a function from the dynamic library currently loaded in the object,
+     *  see get_symbol(symbol_name, version)
+     *
+     *  @throws dylib::symbol_error if the symbol could not be found in this version
+     *
+     *  @param T the template argument must be the function prototype to get
+     *  @param symbol_name the symbol name of a function to get from the dynamic library
+     *  @param version the version of the function
+     *
+     *  @return a pointer to the requested function
+     */
+    ///@{
+    template<typename T>
+    T *get_function(const char *symbol_name, const char *version) const {
+        return function_cast<T>(get_symbol(symbol_name, version));
+    }
+
+    template<typename T>
+    T *get_function(const std::string &symbol_name, const std::string &version) const {
+        return get_function<T>(symbol_name.c_str(), version.c_str());
+    }
+    ///@}
+
+    /**
+     *  Get a function from the dynamic library currently loaded in the object, deferring
+     *  the symbol resolution until the first call
+     *
+     *  @param T the template argument must be the function prototype to get
+     *  @param symbol_name the symbol name of a function to get from the dynamic library
+     *
+     *  @return a lazy handle to the requested function
+     */
+    template<typename T>
+    lazy_function<T> get_lazy_function(const char *symbol_name) const {
+        if (!symbol_name)
+            throw std::invalid_argument("Null parameter");
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+        return lazy_function<T>(m_handle, symbol_name);
+    }
+
+    template<typename T>
+    lazy_function<T> get_lazy_function(const std::string &symbol_name) const {
+        return get_lazy_function<T>(symbol_name.c_str());
+    }
+
+    /**
+     *  Get a function from the dynamic library currently loaded in the object, wrapped in a
+     *  handle that counts and times its calls while profiling is enabled, see set_profiling
+     *
+     *  @throws dylib::symbol_error if the symbol could not be found
+     *
+     *  @param T the template argument must be the function prototype to get
+     *  @param symbol_name the symbol name of a function to get from the dynamic library
+     *
+     *  @return a profiled handle to the requested function
+     */
+    ///@{
+    template<typename T>
+    profiled_function<T> get_profiled_function(const char *symbol_name) const {
+        auto function = get_function<T>(symbol_name);
+        return profiled_function<T>(function, profiler_of(reinterpret_cast<const void *>(function), symbol_name));
+    }
+
+    template<typename T>
+    profiled_function<T> get_profiled_function(const std::string &symbol_name) const {
+        return get_profiled_function<T>(symbol_name.c_str());
+    }
+
+    template<typename T>
+    profiled_function<T> get_profiled_function(const symbol_key &key) const {
+        auto function = get_function<T>(key);
+        return profiled_function<T>(function, profiler_of(reinterpret_cast<const void *>(function), key.name()));
+    }
+    ///@}
+
+    /**
+     *  Enable or disable the profiling of every profiled function of the process, disabled by default
+     *
+     *  @param enabled true to count and time the calls
+     */
+    static void set_profiling(bool enabled) noexcept {
+        profiling_slot().store(enabled, std::memory_order_relaxed);
+    }
+
+    /**
+     *  @return true if the calls of the profiled functions are counted and timed
+     */
+    static bool profiling_enabled() noexcept {
+        return profiling_slot().load(std::memory_order_relaxed);
+    }
+
+    /**
+     *  @return the counters of every profiled function of the process that still has a handle
+     */
+    static std::vector<call_profile> call_profiles() {
+        std::vector<std::shared_ptr<call_profiler>> profilers;
+        {
+            profiler_registry &registry = profilers_of_process();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (const auto &entry : registry.profilers)
+                if (auto profiler = entry.second.lock())
+                    profilers.push_back(std::move(profiler));
+        }
+        std::vector<call_profile> profiles;
+        for (const auto &profiler : profilers)
+            profiles.push_back(profiler->snapshot());
+        return profiles;
+    }
+
+    /**
+     *  Get a variable from the dynamic library currently loaded in the object
+     * 
+     *  @throws dylib::symbol_error if the symbol could not be found
+     *
+     *  @param T the template argument must be the type of the variable to get
+     *  @param symbol_name the symbol name of a variable to get from the dynamic library
+     *
+     *  @return a reference to the requested variable
+     */
+    template<typename T>
+    T &get_variable(const char *symbol_name) const {
+        return *reinterpret_cast<T *>(get_symbol(symbol_name));
+    }
+
+    template<typename T>
+    T &get_variable(const std::string &symbol_name) const {
+        return get_variable<T>(symbol_name.c_str());
+    }
+
+    template<typename T>
+    T &get_variable(const symbol_key &key) const {
+        return *reinterpret_cast<T *>(get_symbol(key));
+    }
+
+    /**
+     *  Get a handle to a variable from the dynamic library currently loaded in the object, resolving
+     *  it once so that polling the variable never goes through the dynamic loader again
+     *
+     *  @throws dylib::symbol_error if the symbol could not be found
+     *
+     *  @param T the template argument must be the type of the variable to get
+     *  @param symbol_name the symbol name of a variable to get from the dynamic library
+     *
+     *  @return a handle to the requested variable
+     */
+    ///@{
+    template<typename T>
+    variable_ref<T> get_variable_ref(const char *symbol_name) const {
+        return variable_ref<T>(reinterpret_cast<T *>(get_symbol(symbol_name)));
+    }
+
+    template<typename T>
+    variable_ref<T> get_variable_ref(const std::string &symbol_name) const {
+        return get_variable_ref<T>(symbol_name.c_str());
+    }
+
+    template<typename T>
+    variable_ref<T> get_variable_ref(const symbol_key &key) const {
+        return variable_ref<T>(reinterpret_cast<T *>(get_symbol(key)));
+    }
+    ///@}
+
+    /**
+     *  Get a given version of a variable from the dynamic library currently loaded in the object,
+     *  see get_symbol(symbol_name, version)
+     *
+     *  @throws dylib::symbol_error if the symbol could not be found in this version
+     *
+     *  @param T the template argument must be the type of the variable to get
+     *  @param symbol_name the symbol name of a variable to get from the dynamic library
+     *  @param version the version of the variable
+     *
+     *  @return a reference to the requested variable
+     */
+    ///@{
+    template<typename T>
+    T &get_variable(const char *symbol_name, const char *version) const {
+        return *reinterpret_cast<T *>(get_symbol(symbol_name, version));
+    }
+
+    template<typename T>
+    T &get_variable(const std::string &symbol_name, const std::string &version) const {
+        return get_variable<T>(symbol_name.c_str(), version.c_str());
+    }
+    ///@}
+
+    /**
+     *  Check if a symbol exists in the currently loaded dynamic library. 
+     *  This method will return false if no dynamic library is currently loaded 
+     *  or if the symbol name is nullptr
+     *
+     *  @param symbol_name the symbol name to look for
+     *
+     *  @return true if the symbol exists in the dynamic library, false otherwise
+     */
+    bool has_symbol(const char *symbol_name) const noexcept {
+        if (!m_handle || !symbol_name)
+            return false;
+        return resolve_symbol(symbol_name) != nullptr;
+    }
+
+    bool has_symbol(const std::string &symbol) const noexcept {
         return has_symbol(symbol.c_str());
     }
 
     /**
-     *  @return the dynamic library handle
+     *  Check if a given version of a symbol exists in the currently loaded dynamic library,
+     *  see get_symbol(symbol_name, version)
+     *
+     *  @param symbol_name the symbol name to look for
+     *  @param version the version of the symbol
+     *
+     *  @return true if the symbol exists in this version, false otherwise
+     */
+    ///@{
+    bool has_symbol(const char *symbol_name, const char *version) const noexcept {
+        if (!m_handle || !symbol_name || !version)
+            return false;
+        return resolve_symbol(symbol_name, version) != nullptr;
+    }
+
+    bool has_symbol(const std::string &symbol, const std::string &version) const noexcept {
+        return has_symbol(symbol.c_str(), version.c_str());
+    }
+    ///@}
+
+    /**
+     *  Associates a symbol name with a function pointer member of a binding table
+     *
+     *  @param Table the binding table type
+     *  @param T the function prototype of the member
+     */
+    template<typename Table, typename T>
+    struct binding {
+        T *Table::*member;
+        const char *name;
+    };
+
+    /**
+     *  Create the binding of a function pointer member to a symbol name, to be used with bind
+     *
+     *  @param member the function pointer member of the binding table
+     *  @param symbol_name the symbol name of the function to store in the member
+     *
+     *  @return the binding of the member to the symbol name
+     */
+    template<typename Table, typename T>
+    static constexpr binding<Table, T> bind_symbol(T *Table::*member, const char *symbol_name) noexcept {
+        return binding<Table, T>{member, symbol_name};
+    }
+
+    /**
+     *  Resolve a whole table of functions in one pass. Every binding fills one function
+     *  pointer member of a default initialized Table, which can then be called through
+     *  directly without any further lookup. Without arguments, the bindings are taken
+     *  from the tuple returned by the static member function Table::symbols()
+     *
+     *  @throws dylib::symbol_error listing every symbol that could not be found
+     *
+     *  @param Table the binding table type, usually a struct of function pointers
+     *  @param bindings the bindings created by bind_symbol
+     *
+     *  @return the binding table filled with the requested functions
+     */
+    ///@{
+    template<typename Table, typename T, typename... Ts>
+    Table bind(const binding<Table, T> &first, const binding<Table, Ts> &... others) const {
+        return bind_table<Table>(std::make_tuple(first, others...));
+    }
+
+    template<typename Table>
+    Table bind() const {
+        return bind_table<Table>(Table::symbols());
+    }
+    ///@}
+
+    /**
+     *  Enable the symbol cache of the object. Once enabled, every symbol successfully
+     *  resolved by get_symbol, get_function, get_variable or has_symbol is remembered,
+     *  so that looking it up again costs a single hash probe instead of a call to the
+     *  dynamic loader. The cache is owned by the object and follows it when moved.
+     *  Lookups may run concurrently from any number of threads, but enabling, disabling
+     *  and moving the cache must not race with them
+     */
+    void enable_symbol_cache() {
+        if (!m_symbol_cache)
+            m_symbol_cache.reset(new symbol_cache());
+    }
+
+    /**
+     *  Disable the symbol cache of the object and release every cached symbol
+     */
+    void disable_symbol_cache() noexcept {
+        m_symbol_cache.reset();
+    }
+
+    /**
+     *  @return true if the symbol cache is enabled, false otherwise
+     */
+    bool symbol_cache_enabled() const noexcept {
+        return m_symbol_cache != nullptr;
+    }
+
+    /**
+     *  Resolve a batch of symbols into the symbol cache, enabling it if needed,
+     *  so that the next lookups of these symbols never reach the dynamic loader
+     *
+     *  @throws dylib::symbol_error listing every symbol that could not be found
+     *
+     *  @param symbols the symbol names to resolve
+     */
+    void preload_symbols(const std::vector<std::string> &symbols) {
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+        enable_symbol_cache();
+
+        std::string missing;
+        std::string descriptions;
+        for (auto &name : symbols) {
+            if (resolve_symbol(name.c_str()) == nullptr) {
+                missing += (missing.empty() ? "\"" : ", \"") + name + "\"";
+                descriptions += (descriptions.empty() ? "" : "\n") + lookup_error_description();
+            }
+        }
+        if (!missing.empty())
+            throw symbol_error("Could not get symbols " + missing + "\n" + descriptions);
+    }
+
+    /**
+     *  A symbol exported by a dynamic library, see exported_symbols
+     */
+    struct exported_symbol {
+        /** the name of the symbol, pointing into the string table of the loaded library */
+        const char *name;
+        /** the address of the symbol */
+        native_symbol_type address;
+    };
+
+    /**
+     *  A view over the export table of a loaded library, read in place from its mapped image,
+     *  so iterating over it never allocates. The view is valid as long as the library stays loaded
+     */
+    class export_table {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = exported_symbol;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const exported_symbol *;
+            using reference = const exported_symbol &;
+
+            iterator() noexcept = default;
+
+            reference operator*() const noexcept {
+                return m_current;
+            }
+
+            pointer operator->() const noexcept {
+                return &m_current;
+            }
+
+            iterator &operator++() noexcept {
+                m_index++;
+                settle();
+                return *this;
+            }
+
+            iterator operator++(int) noexcept {
+                iterator previous = *this;
+                ++*this;
+                return previous;
+            }
+
+            friend bool operator==(const iterator &lhs, const iterator &rhs) noexcept {
+                return lhs.m_index == rhs.m_index;
+            }
+
+            friend bool operator!=(const iterator &lhs, const iterator &rhs) noexcept {
+                return lhs.m_index != rhs.m_index;
+            }
+
+        private:
+            const export_table *m_table{nullptr};
+            std::size_t m_index{0};
+            exported_symbol m_current{nullptr, nullptr};
+
+            iterator(const export_table *table, std::size_t index) noexcept : m_table(table), m_index(index) {
+                settle();
+            }
+
+            void settle() noexcept {
+                while (m_index < m_table->m_count && !m_table->read(m_index, m_current))
+                    m_index++;
+            }
+
+            friend class export_table;
+        };
+
+        iterator begin() const noexcept {
+            return iterator(this, 0);
+        }
+
+        iterator end() const noexcept {
+            return iterator(this, m_count);
+        }
+
+    private:
+        native_handle_type m_handle{nullptr};
+        std::uintptr_t m_base{0};
+        const void *m_symbols{nullptr};
+        const char *m_strings{nullptr};
+        std::size_t m_count{0};
+#if (defined(_WIN32) || defined(_WIN64))
+        const WORD *m_ordinals{nullptr};
+        const DWORD *m_functions{nullptr};
+        DWORD m_directory_begin{0};
+        DWORD m_directory_end{0};
+#elif !defined(__APPLE__)
+        const ElfW(Half) *m_versions{nullptr};
+#endif
+
+        export_table() noexcept = default;
+
+        bool read(std::size_t index, exported_symbol &out) const noexcept {
+#if (defined(_WIN32) || defined(_WIN64))
+            const char *name = reinterpret_cast<const char *>(m_base + static_cast<const DWORD *>(m_symbols)[index]);
+            const DWORD address = m_functions[m_ordinals[index]];
+            out.name = name;
+            if (address >= m_directory_begin && address < m_directory_end)
+                out.address = locate_symbol(m_handle, name);  // forwarded to another library
+            else
+                out.address = reinterpret_cast<native_symbol_type>(m_base + address);
+            return out.address != nullptr;
+#elif defined(__APPLE__)
+            const macho::nlist_64 &symbol = static_cast<const macho::nlist_64 *>(m_symbols)[index];
+            if ((symbol.n_type & macho::n_stab) || (symbol.n_type & macho::n_pext) || !(symbol.n_type & macho::n_ext))
+                return false;
+            if ((symbol.n_type & macho::n_type_mask) != macho::n_sect)
+                return false;
+            const char *name = m_strings + symbol.n_un.n_strx;
+            out.name = name[0] == '_' ? name + 1 : name;
+            out.address = reinterpret_cast<native_symbol_type>(m_base + symbol.n_value);
+            return true;
+#else
+            const ElfW(Sym) &symbol = static_cast<const ElfW(Sym) *>(m_symbols)[index];
+            const unsigned char binding = ELF64_ST_BIND(symbol.st_info);
+            const unsigned char type = ELF64_ST_TYPE(symbol.st_info);
+            if (symbol.st_shndx == SHN_UNDEF || symbol.st_name == 0 || type == STT_TLS)
+                return false;
+            if (symbol.st_shndx == SHN_ABS)
+                return false;  // not an address in the library, e.g. the names of version definitions
+            if (binding != STB_GLOBAL && binding != STB_WEAK && binding != STB_GNU_UNIQUE)
+                return false;
+            if (m_versions && (m_versions[index] & 0x8000))
+                return false;  // hidden, non-default version of a versioned symbol
+            out.name = m_strings + symbol.st_name;
+            if (type == STT_GNU_IFUNC)
+                out.address = locate_symbol(m_handle, out.name);
+            else
+                out.address = reinterpret_cast<native_symbol_type>(m_base + symbol.st_value);
+            return out.address != nullptr;
+#endif
+        }
+
+        friend class dylib;
+    };
+
+    /**
+     *  List the symbols exported by the dynamic library currently loaded in the object, read
+     *  straight from the export table of its image in a single linear scan, instead of probing
+     *  names one by one with has_symbol. Only the library's own exports are listed, not the ones
+     *  of its dependencies
+     *
+     *  @code
+     *  for (auto &symbol : lib.exported_symbols())
+     *      std::cout << symbol.name << std::endl;
+     *  @endcode
+     *
+     *  @throws std::logic_error if the dynamic library handle is null
+     *  @throws dylib::symbol_error if the export table could not be read
+     *
+     *  @return a view over the export table, valid as long as the library stays loaded
+     */
+    export_table exported_symbols() const {
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+        export_table table;
+        table.m_handle = m_handle;
+        if (!read_export_table(table))
+            throw symbol_error("Could not read the export table\n" + get_error_description());
+        return table;
+    }
+
+    /**
+     *  Find the exported symbols whose name starts with a prefix, in a single scan of the export table
+     *
+     *  @code
+     *  for (auto &handler : lib.find_symbols("handler_"))
+     *      handlers[handler.name + 8] = reinterpret_cast<handler_type *>(handler.address);
+     *  @endcode
+     *
+     *  @throws std::invalid_argument if the prefix is null
+     *  @throws std::logic_error if the dynamic library handle is null
+     *  @throws dylib::symbol_error if the export table could not be read
+     *
+     *  @param prefix the beginning of the names to match
+     *
+     *  @return the matching symbols, whose names stay valid as long as the library stays loaded
+     */
+    ///@{
+    std::vector<exported_symbol> find_symbols(const char *prefix) const {
+        if (!prefix)
+            throw std::invalid_argument("Null parameter");
+        const std::size_t length = std::strlen(prefix);
+        return find_symbols_if([prefix, length](const exported_symbol &symbol) {
+            return std::strncmp(symbol.name, prefix, length) == 0;
+        });
+    }
+
+    std::vector<exported_symbol> find_symbols(const std::string &prefix) const {
+        return find_symbols(prefix.c_str());
+    }
+    ///@}
+
+    /**
+     *  Find the exported symbols accepted by a predicate, in a single scan of the export table
+     *
+     *  @throws std::logic_error if the dynamic library handle is null
+     *  @throws dylib::symbol_error if the export table could not be read
+     *
+     *  @param predicate a callable taking a const exported_symbol & and returning true to keep it
+     *
+     *  @return the matching symbols, whose names stay valid as long as the library stays loaded
+     */
+    template<typename Predicate>
+    std::vector<exported_symbol> find_symbols_if(Predicate predicate) const {
+        std::vector<exported_symbol> symbols;
+        for (auto &symbol : exported_symbols())
+            if (predicate(symbol))
+                symbols.push_back(symbol);
+        return symbols;
+    }
+
+    /**
+     *  Insert every exported symbol into the symbol cache, enabling it if needed,
+     *  so that the next lookups of these symbols never reach the dynamic loader
+     *
+     *  @throws std::logic_error if the dynamic library handle is null
+     *  @throws dylib::symbol_error if the export table could not be read
+     *
+     *  @return the number of exported symbols
+     */
+    std::size_t preload_exported_symbols() {
+        const export_table table = exported_symbols();
+        enable_symbol_cache();
+
+        std::size_t count = 0;
+        for (auto &symbol : table) {
+            m_symbol_cache->insert(symbol.name, hash_symbol_name(symbol.name), symbol.address);
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     *  A read-only view over a plugin manifest, a sidecar file generated at build time next to a
+     *  library (see cmake/dylib_manifest.cmake) and indexing its exported names, their hashes and
+     *  an ABI tag. The whole file is mapped with a single mmap, so plugins can be filtered on their
+     *  ABI and capabilities without opening the ones that would be rejected
+     *
+     *  The file is made of a header, an array of entries sorted by hash, then a string table:
+     *  all fields are stored in the byte order of the machine that generated the manifest
+     */
+    class manifest {
+    public:
+        static constexpr const char *extension = ".dlmanifest";
+        static constexpr std::uint32_t format_version = 1;
+
+        manifest(const manifest&) = delete;
+        manifest& operator=(const manifest&) = delete;
+
+        manifest(manifest &&other) noexcept : m_path(std::move(other.m_path)), m_data(other.m_data), m_size(other.m_size) {
+            other.m_data = nullptr;
+            other.m_size = 0;
+        }
+
+        manifest& operator=(manifest &&other) noexcept {
+            if (this != &other) {
+                std::swap(m_path, other.m_path);
+                std::swap(m_data, other.m_data);
+                std::swap(m_size, other.m_size);
+            }
+            return *this;
+        }
+
+        /**
+         *  @brief Maps the manifest file of a library
+         *
+         *  @throws dylib::load_error if the manifest could not be read or is not a valid manifest
+         *
+         *  @param manifest_path the path of the manifest file
+         */
+        explicit manifest(const std::string &manifest_path) : m_path(manifest_path) {
+            map();
+        }
+
+        /**
+         *  @brief Maps the manifest file generated next to a library
+         *
+         *  @throws dylib::load_error if the manifest could not be read or is not a valid manifest
+         *
+         *  @param dir_path the directory path where is located the dynamic library
+         *  @param lib_name the name of the dynamic library
+         *  @param decorations add os decorations to the library name
+         */
+        manifest(const std::string &dir_path, const std::string &lib_name, bool decorations = add_filename_decorations)
+            : m_path(dylib::library_path(dir_path.c_str(), lib_name.c_str(), decorations) + extension) {
+            map();
+        }
+
+        ~manifest() {
+            if (m_data)
+                DYLIB_WIN_OTHER(UnmapViewOfFile(m_data), munmap(const_cast<char *>(m_data), m_size));
+        }
+
+        /**
+         *  @return the path of the library described by the manifest, to be loaded without decorations
+         */
+        std::string library_path() const {
+            return m_path.substr(0, m_path.size() - std::min(m_path.size(), std::strlen(extension)));
+        }
+
+        /**
+         *  @return the ABI tag the library was built with
+         */
+        const char *abi() const noexcept {
+            return string_at(header().abi_offset);
+        }
+
+        /**
+         *  @return the number of exported names indexed by the manifest
+         */
+        std::size_t size() const noexcept {
+            return header().symbol_count;
+        }
+
+        /**
+         *  @return the exported name at the given index, in hash order, or nullptr if out of range
+         */
+        const char *name(std::size_t index) const noexcept {
+            return index < size() ? string_at(entries()[index].name_offset) : nullptr;
+        }
+
+        /**
+         *  Check if the library exports a symbol without opening it, in a single binary search
+         *
+         *  @param symbol the symbol name to look for
+         *
+         *  @return true if the manifest lists the symbol, false otherwise
+         */
+        ///@{
+        bool has_symbol(const char *symbol) const noexcept {
+            if (!symbol)
+                return false;
+            const std::uint64_t hash = hash_symbol_name(symbol);
+            const entry *first = entries();
+            const entry *last = first + size();
+            const entry *it = std::lower_bound(first, last, hash,
+                [](const entry &item, std::uint64_t value) { return item.hash < value; });
+            for (; it != last && it->hash == hash; ++it) {
+                const char *name = string_at(it->name_offset);
+                if (name && std::strcmp(name, symbol) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        bool has_symbol(const std::string &symbol) const noexcept {
+            return has_symbol(symbol.c_str());
+        }
+        ///@}
+
+        /**
+         *  @brief Writes the manifest of a library, as done at build time by tools/dylib_manifest.cpp
+         *
+         *  @throws dylib::exception if the manifest could not be written
+         *
+         *  @param manifest_path the path of the manifest file to create
+         *  @param abi the ABI tag of the library
+         *  @param symbols the names exported by the library
+         */
+        static void write(const std::string &manifest_path, const std::string &abi, std::vector<std::string> symbols) {
+            std::vector<std::pair<std::uint64_t, std::string>> names;
+            names.reserve(symbols.size());
+            for (auto &symbol : symbols)
+                names.emplace_back(hash_symbol_name(symbol.c_str()), std::move(symbol));
+            std::sort(names.begin(), names.end());
+            names.erase(std::unique(names.begin(), names.end()), names.end());
+
+            std::string strings = abi + '\0';
+            std::vector<entry> table;
+            table.reserve(names.size());
+            for (auto &name : names) {
+                table.push_back(entry{name.first, static_cast<std::uint32_t>(strings.size()), 0});
+                strings.append(name.second).push_back('\0');
+            }
+
+            file_header head{};
+            std::memcpy(head.magic, "DLMF", sizeof(head.magic));
+            head.version = format_version;
+            head.symbol_count = static_cast<std::uint32_t>(table.size());
+            head.abi_offset = 0;
+            head.entries_offset = sizeof(file_header);
+            head.strings_offset = static_cast<std::uint32_t>(sizeof(file_header) + table.size() * sizeof(entry));
+            head.strings_size = static_cast<std::uint32_t>(strings.size());
+            if (head.strings_offset + static_cast<std::uint64_t>(strings.size()) > UINT32_MAX)
+                throw exception("Could not write manifest \"" + manifest_path + "\"\nToo many symbols");
+
+#if defined(_MSC_VER)
+            std::FILE *file = nullptr;
+            if (fopen_s(&file, manifest_path.c_str(), "wb") != 0)
+                file = nullptr;
+#else
+            std::FILE *file = std::fopen(manifest_path.c_str(), "wb");
+#endif
+            bool written = file != nullptr;
+            written = written && std::fwrite(&head, sizeof(head), 1, file) == 1;
+            written = written && (table.empty() || std::fwrite(table.data(), sizeof(entry), table.size(), file) == table.size());
+            written = written && std::fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+            if (file && std::fclose(file) != 0)
+                written = false;
+            if (!written) {
+                std::remove(manifest_path.c_str());
+                throw exception("Could not write manifest \"" + manifest_path + "\"");
+            }
+        }
+
+    private:
+        struct file_header {
+            char magic[4];
+            std::uint32_t version;
+            std::uint32_t symbol_count;
+            std::uint32_t abi_offset;
+            std::uint32_t entries_offset;
+            std::uint32_t strings_offset;
+            std::uint32_t strings_size;
+            std::uint32_t reserved;
+        };
+
+        struct entry {
+            std::uint64_t hash;
+            std::uint32_t name_offset;
+            std::uint32_t reserved;
+        };
+
+        std::string m_path{};
+        const char *m_data{nullptr};
+        std::size_t m_size{0};
+
+        friend class dylib;
+
+        const file_header &header() const noexcept {
+            return *reinterpret_cast<const file_header *>(m_data);
+        }
+
+        const entry *entries() const noexcept {
+            return reinterpret_cast<const entry *>(m_data + header().entries_offset);
+        }
+
+        const char *string_at(std::uint32_t offset) const noexcept {
+            const file_header &head = header();
+            if (offset >= head.strings_size)
+                return nullptr;
+            return m_data + head.strings_offset + offset;
+        }
+
+        void map() {
+#if (defined(_WIN32) || defined(_WIN64))
+            HANDLE file = CreateFileA(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL, nullptr);
+            LARGE_INTEGER length{};
+            HANDLE mapping = nullptr;
+            if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &length) && length.QuadPart != 0)
+                mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                m_data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                m_size = m_data ? static_cast<std::size_t>(length.QuadPart) : 0;
+            }
+            const std::string description = m_data ? std::string() : get_error_description();
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+            if (!m_data)
+                throw load_error("Could not read manifest \"" + m_path + "\"\n" + description);
+#else
+            const int descriptor = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat status;
+            void *data = MAP_FAILED;
+            if (descriptor >= 0 && fstat(descriptor, &status) == 0) {
+                m_size = static_cast<std::size_t>(status.st_size);
+                data = m_size < sizeof(file_header) ? nullptr
+                     : mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            }
+            const std::string description = data == MAP_FAILED ? std::strerror(errno) : "Invalid manifest format";
+            if (descriptor >= 0)
+                ::close(descriptor);
+            if (data == MAP_FAILED || data == nullptr) {
+                m_size = 0;
+                throw load_error("Could not read manifest \"" + m_path + "\"\n" + description);
+            }
+            m_data = static_cast<const char *>(data);
+#endif
+            if (!valid()) {
+                DYLIB_WIN_OTHER(UnmapViewOfFile(m_data), munmap(const_cast<char *>(m_data), m_size));
+                m_data = nullptr;
+                m_size = 0;
+                throw load_error("Could not read manifest \"" + m_path + "\"\nInvalid manifest format");
+            }
+        }
+
+        bool valid() const noexcept {
+            if (m_size < sizeof(file_header))
+                return false;
+            const file_header &head = header();
+            const std::uint64_t entries_end = head.entries_offset + static_cast<std::uint64_t>(head.symbol_count) * sizeof(entry);
+            const bool layout = std::memcmp(head.magic, "DLMF", sizeof(head.magic)) == 0 && head.version == format_version
+                && head.entries_offset % alignof(entry) == 0 && head.entries_offset >= sizeof(file_header)
+                && entries_end <= head.strings_offset && head.strings_size != 0
+                && head.strings_offset + static_cast<std::uint64_t>(head.strings_size) <= m_size
+                && m_data[head.strings_offset + head.strings_size - 1] == '\0'
+                && head.abi_offset < head.strings_size;
+            if (!layout)
+                return false;
+            // every string of a valid manifest can be read, abi() and name() never return nullptr in range
+            const entry *first = entries();
+            return std::all_of(first, first + head.symbol_count,
+                [&head](const entry &item) { return item.name_offset < head.strings_size; });
+        }
+    };
+
+    /**
+     *  Resolve every symbol listed by a manifest into the symbol cache, enabling it if needed,
+     *  reusing the hashes stored in the manifest instead of hashing each name again
+     *
+     *  @throws dylib::symbol_error listing every symbol that could not be found, e.g. when the
+     *  manifest is stale
+     *
+     *  @param symbols the manifest of the loaded library
+     */
+    void preload_manifest(const manifest &symbols) {
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+        enable_symbol_cache();
+
+        std::string missing;
+        std::string descriptions;
+        for (std::size_t i = 0; i < symbols.size(); i++) {
+            const char *name = symbols.name(i);
+            if (!name)
+                continue;
+            const std::uint64_t hash = symbols.entries()[i].hash;
+            if (m_symbol_cache->find(name, hash) != nullptr)
+                continue;
+            native_symbol_type symbol = locate_symbol(m_handle, name);
+            if (symbol) {
+                m_symbol_cache->insert(name, hash, symbol);
+            } else {
+                missing += (missing.empty() ? "\"" : ", \"") + std::string(name) + "\"";
+                descriptions += (descriptions.empty() ? "" : "\n") + lookup_error_description();
+            }
+        }
+        if (!missing.empty())
+            throw symbol_error("Could not get symbols " + missing + "\n" + descriptions);
+    }
+
+    /**
+     *  A process-wide table of the loaded libraries, keyed by canonical path. Opening a library
+     *  through the registry while another holder still uses it returns the same object, so the
+     *  library is opened once, its symbol cache is shared by every holder, and it is closed when
+     *  the last holder releases it. The table is split into independently locked stripes, so
+     *  concurrent opens of different libraries rarely contend, and no lock is held while a library
+     *  loads: the concurrent opens of the same library wait for the first one, the others go on
+     */
+    class registry {
+    public:
+        registry() : m_state(std::make_shared<state>()) {}
+
+        registry(const registry&) = delete;
+        registry& operator=(const registry&) = delete;
+
+        /**
+         *  @return the process-wide registry
+         */
+        static registry &instance() {
+            static registry global_registry;
+            return global_registry;
+        }
+
+        /**
+         *  Get a shared dynamic library, loading it if no holder currently uses it.
+         *  The library is const, so that no holder can disable its shared symbol cache or move from it
+         *
+         *  @throws dylib::load_error if the library could not be opened
+         *
+         *  @param dir_path the directory path where is located the dynamic library you want to load
+         *  @param name the name of the dynamic library to load
+         *  @param decorations add os decorations to the library name
+         *  @param options the flags to load the dynamic library with, if it is not already loaded
+         *
+         *  @return the shared dynamic library
+         */
+        ///@{
+        std::shared_ptr<const dylib> open(const char *dir_path, const char *lib_name, bool decorations = add_filename_decorations,
+            load_options options = load_options::defaults) {
+            if (!dir_path || !lib_name)
+                throw std::invalid_argument("Null parameter");
+
+            const std::string key = canonical_path(library_path(dir_path, lib_name, decorations));
+            stripe &bucket = m_state->stripes[std::hash<std::string>()(key) % stripe_count];
+            std::promise<std::shared_ptr<const dylib>> loaded;
+            std::shared_future<std::shared_ptr<const dylib>> loading;
+            {
+                std::lock_guard<std::mutex> lock(bucket.mutex);
+                entry &item = bucket.libraries[key];
+                auto lib = item.library.lock();
+                if (lib)
+                    return lib;
+                if (item.loading.valid())
+                    loading = item.loading;
+                else
+                    item.loading = loaded.get_future().share();
+            }
+            // another thread is loading it, throws its dylib::load_error if it fails
+            if (loading.valid())
+                return loading.get();
+
+            std::shared_ptr<dylib> lib;
+            try {
+                std::weak_ptr<state> owner = m_state;
+                lib.reset(new dylib(key.c_str(), no_filename_decorations, options),
+                    [owner, key](dylib *released) { release(owner, key, released); });
+                lib->enable_symbol_cache();
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(bucket.mutex);
+                    bucket.libraries.erase(key);
+                }
+                loaded.set_exception(std::current_exception());
+                throw;
+            }
+            {
+                std::lock_guard<std::mutex> lock(bucket.mutex);
+                entry &item = bucket.libraries[key];
+                item.library = lib;
+                item.loading = std::shared_future<std::shared_ptr<const dylib>>();
+            }
+            loaded.set_value(lib);
+            return lib;
+        }
+
+        std::shared_ptr<const dylib> open(const std::string &dir_path, const std::string &lib_name,
+            bool decorations = add_filename_decorations, load_options options = load_options::defaults) {
+            return open(dir_path.c_str(), lib_name.c_str(), decorations, options);
+        }
+
+        std::shared_ptr<const dylib> open(const std::string &lib_name, bool decorations = add_filename_decorations,
+            load_options options = load_options::defaults) {
+            return open("", lib_name.c_str(), decorations, options);
+        }
+
+        std::shared_ptr<const dylib> open(const char *lib_name, bool decorations = add_filename_decorations,
+            load_options options = load_options::defaults) {
+            return open("", lib_name, decorations, options);
+        }
+        ///@}
+
+        /**
+         *  @return the number of libraries currently held through the registry
+         */
+        std::size_t size() const {
+            std::size_t count = 0;
+            for (auto &bucket : m_state->stripes) {
+                std::lock_guard<std::mutex> lock(bucket.mutex);
+                count += bucket.libraries.size();
+            }
+            return count;
+        }
+
+    private:
+        static constexpr std::size_t stripe_count = 16;
+
+        struct entry {
+            std::weak_ptr<dylib> library{};
+            /** valid while the library is being loaded by the first opener */
+            std::shared_future<std::shared_ptr<const dylib>> loading{};
+        };
+
+        struct stripe {
+            std::mutex mutex{};
+            std::unordered_map<std::string, entry> libraries{};
+        };
+
+        struct state {
+            stripe stripes[stripe_count];
+        };
+
+        std::shared_ptr<state> m_state;
+
+        static void release(const std::weak_ptr<state> &owner, const std::string &key, dylib *lib) noexcept {
+            auto registry_state = owner.lock();
+            if (registry_state) {
+                stripe &bucket = registry_state->stripes[std::hash<std::string>()(key) % stripe_count];
+                std::lock_guard<std::mutex> lock(bucket.mutex);
+                auto it = bucket.libraries.find(key);
+                if (it != bucket.libraries.end() && it->second.library.expired() && !it->second.loading.valid())
+                    bucket.libraries.erase(it);
+            }
+            delete lib;
+        }
+    };
+
+    /**
+     *  A dynamic library that can be replaced while it is in use. A fixed set of symbols is resolved
+     *  on every load and published with a single atomic pointer swap; callers read them through a
+     *  guard, and the previous version is only closed once every guard taken on it is released.
+     *  Each version is loaded from a private copy of the file in the temporary directory, so the
+     *  original can be overwritten in place without corrupting the mapped image, and its directory
+     *  may be read-only. The dependencies that are found relative to the library, such as through
+     *  $ORIGIN, must therefore be reachable from the temporary directory too
+     */
+    class reloadable {
+        struct version;
+
+    public:
+        /**
+         *  Pins the version of the library that was current when the guard was taken,
+         *  so its symbols stay valid until the guard is destroyed, even across reloads
+         */
+        class guard {
+        public:
+            guard(guard &&other) noexcept : m_readers(other.m_readers), m_version(other.m_version) {
+                other.m_readers = nullptr;
+            }
+
+            guard(const guard&) = delete;
+            guard& operator=(const guard&) = delete;
+            guard& operator=(guard&&) = delete;
+
+            ~guard() {
+                if (m_readers)
+                    m_readers->fetch_sub(1, std::memory_order_release);
+            }
+
+            /**
+             *  @param index the position of the symbol in the list given to the constructor
+             *
+             *  @return the resolved symbol
+             */
+            native_symbol_type get_symbol(std::size_t index) const noexcept {
+                return m_version->symbols[index];
+            }
+
+            /**
+             *  @param index the position of the function in the list given to the constructor
+             *
+             *  @return a pointer to the function
+             */
+            template<typename T>
+            T *get_function(std::size_t index) const noexcept {
+                return function_cast<T>(get_symbol(index));
+            }
+
+            /**
+             *  @param index the position of the variable in the list given to the constructor
+             *
+             *  @return a reference to the variable
+             */
+            template<typename T>
+            T &get_variable(std::size_t index) const noexcept {
+                return *reinterpret_cast<T *>(get_symbol(index));
+            }
+
+            /**
+             *  @return the pinned version of the library, to look up other symbols
+             */
+            const dylib &library() const noexcept {
+                return *m_version->library;
+            }
+
+            /**
+             *  @return the number of the pinned version, starting at 1 and increased by every reload
+             */
+            std::uint64_t generation() const noexcept {
+                return m_version->generation;
+            }
+
+        private:
+            std::atomic<unsigned> *m_readers{nullptr};
+            const version *m_version{nullptr};
+
+            explicit guard(const reloadable &owner) noexcept {
+                m_readers = &owner.m_readers[owner.m_epoch.load() & 1];
+                m_readers->fetch_add(1);
+                m_version = owner.m_current.load();
+            }
+
+            friend class reloadable;
+        };
+
+        /**
+         *  Load the first version of a reloadable library
+         *
+         *  @throws dylib::load_error if the library could not be copied or opened
+         *  @throws dylib::symbol_error listing every symbol that could not be found
+         *
+         *  @param dir_path the directory path where is located the dynamic library you want to load
+         *  @param lib_name the name of the dynamic library to load
+         *  @param symbols the symbols resolved on every load, accessed by position through a guard
+         *  @param decorations add os decorations to the library name
+         *  @param options the flags to load every version of the library with
+         */
+        reloadable(const std::string &dir_path, const std::string &lib_name, std::vector<std::string> symbols,
+            bool decorations = add_filename_decorations, load_options options = load_options::defaults)
+            : m_directory(dir_path.empty() ? "." : dir_path),
+              m_file_name(library_path("", lib_name.c_str(), decorations)),
+              m_path(library_path(dir_path.c_str(), lib_name.c_str(), decorations)),
+              m_symbols(std::move(symbols)),
+              m_options(options) {
+            m_current.store(load_version(1).release());
+        }
+
+        reloadable(const reloadable&) = delete;
+        reloadable& operator=(const reloadable&) = delete;
+
+        ~reloadable() {
+            stop_watching();
+            delete m_current.load();
+        }
+
+        /**
+         *  Pin the current version of the library. Taking a guard never blocks
+         *
+         *  @return a guard giving access to the symbols of the current version
+         */
+        guard acquire() const noexcept {
+            return guard(*this);
+        }
+
+        /**
+         *  @return the number of the current version, starting at 1 and increased by every reload
+         */
+        std::uint64_t generation() const noexcept {
+            return acquire().generation();
+        }
+
+        /**
+         *  Load the library file again, resolve the symbols in the new version, publish it, then
+         *  wait for the guards taken on the previous version to be released before closing it.
+         *  If the new version fails to load, the current one stays published.
+         *  The calling thread must not hold a guard of this library, or the wait never ends; the
+         *  on_reload callback of watch runs once the wait is over, so it may take guards
+         *
+         *  @throws dylib::load_error if the library could not be copied or opened
+         *  @throws dylib::symbol_error listing every symbol that could not be found
+         */
+        void reload() {
+            std::lock_guard<std::mutex> lock(m_reload_mutex);
+            std::unique_ptr<version> next = load_version(m_current.load()->generation + 1);
+            std::unique_ptr<version> previous(m_current.exchange(next.release()));
+            synchronize();
+        }
+
+        /**
+         *  Watch the library file from a background thread, reloading it every time it changes.
+         *  On Linux, changes are notified by inotify; elsewhere, the file is polled every 250ms.
+         *  Does nothing if the file is already watched
+         *
+         *  @throws dylib::exception if the directory of the library could not be watched
+         *
+         *  @param on_reload called from the watcher thread after every reload, with a null
+         *  exception_ptr when it succeeded, or the exception it failed with. It must not throw
+         */
+        void watch(std::function<void(std::exception_ptr)> on_reload = nullptr) {
+            std::lock_guard<std::mutex> lock(m_watch_mutex);
+            if (m_watcher.joinable())
+                return;
+            m_on_reload = std::move(on_reload);
+#if defined(__linux__)
+            m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (m_inotify < 0 || inotify_add_watch(m_inotify, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+                pipe(m_stop_pipe) != 0) {
+                const std::string description = std::strerror(errno);
+                close_watch_descriptors();
+                throw exception("Could not watch \"" + m_directory + "\"\n" + description);
+            }
+#else
+            m_stop = false;
+#endif
+            m_watcher = std::thread(&reloadable::watch_loop, this);
+        }
+
+        /**
+         *  Stop watching the library file, waiting for a reload in progress to finish
+         */
+        void stop_watching() noexcept {
+            std::lock_guard<std::mutex> lock(m_watch_mutex);
+            if (!m_watcher.joinable())
+                return;
+#if defined(__linux__)
+            const char signal = 0;
+            while (::write(m_stop_pipe[1], &signal, 1) < 0 && errno == EINTR) {}
+            m_watcher.join();
+            close_watch_descriptors();
+#else
+            {
+                std::lock_guard<std::mutex> stop_lock(m_stop_mutex);
+                m_stop = true;
+            }
+            m_stop_condition.notify_one();
+            m_watcher.join();
+#endif
+        }
+
+    private:
+        struct version {
+            std::unique_ptr<dylib> library{};
+            std::vector<native_symbol_type> symbols{};
+            std::string copy_path{};
+            std::uint64_t generation{0};
+
+            version() = default;
+
+            ~version() {
+                if (copy_path.empty())
+                    return;
+                library.reset();
+                std::remove(copy_path.c_str());
+            }
+        };
+
+        const std::string m_directory;
+        const std::string m_file_name;
+        const std::string m_path;
+        const std::vector<std::string> m_symbols;
+        const load_options m_options;
+
+        std::atomic<version *> m_current{nullptr};
+        std::atomic<unsigned> m_epoch{0};
+        mutable std::atomic<unsigned> m_readers[2]{};
+        std::mutex m_reload_mutex{};
+
+        std::mutex m_watch_mutex{};
+        std::thread m_watcher{};
+        std::function<void(std::exception_ptr)> m_on_reload{};
+#if defined(__linux__)
+        int m_inotify{-1};
+        int m_stop_pipe[2]{-1, -1};
+#else
+        std::mutex m_stop_mutex{};
+        std::condition_variable m_stop_condition{};
+        bool m_stop{false};
+#endif
+
+        std::unique_ptr<version> load_version(std::uint64_t generation) const {
+            const std::string copy_path = unique_copy_path(m_path);
+            if (!copy_file(m_path, copy_path))
+                throw load_error("Could not load library \"" + m_path + "\"\nCould not copy it to \"" + copy_path + "\"");
+
+            std::unique_ptr<version> next(new version());
+            next->generation = generation;
+            try {
+                next->library.reset(new dylib(copy_path.c_str(), no_filename_decorations, m_options));
+            } catch (...) {
+                std::remove(copy_path.c_str());
+                throw;
+            }
+#if (defined(_WIN32) || defined(_WIN64))
+            // a loaded DLL cannot be deleted, the copy is removed once the version is closed
+            next->copy_path = copy_path;
+#else
+            std::remove(copy_path.c_str());
+#endif
+
+            std::string missing;
+            std::string descriptions;
+            for (auto &name : m_symbols) {
+                auto symbol = locate_symbol(next->library->m_handle, name.c_str());
+                if (symbol == nullptr) {
+                    missing += (missing.empty() ? "\"" : ", \"") + name + "\"";
+                    descriptions += (descriptions.empty() ? "" : "\n") + lookup_error_description();
+                }
+                next->symbols.push_back(symbol);
+            }
+            if (!missing.empty())
+                throw symbol_error("Could not get symbols " + missing + "\n" + descriptions);
+            return next;
+        }
+
+        /**
+         *  Wait until no guard can still reference the version replaced by the last swap.
+         *  Guards register on the counter of the current epoch parity, so flipping the epoch
+         *  and draining the old parity twice covers guards that read the epoch before a flip
+         *  but registered after it, while new guards never delay the wait
+         */
+        void synchronize() noexcept {
+            for (int phase = 0; phase < 2; phase++) {
+                const unsigned parity = m_epoch.fetch_add(1) & 1;
+                while (m_readers[parity].load(std::memory_order_acquire) != 0)
+                    std::this_thread::yield();
+            }
+        }
+
+        void reload_and_notify() noexcept {
+            std::exception_ptr error = nullptr;
+            try {
+                reload();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (m_on_reload)
+                m_on_reload(error);
+        }
+
+#if defined(__linux__)
+        void watch_loop() noexcept {
+            struct pollfd descriptors[2] = {{m_inotify, POLLIN, 0}, {m_stop_pipe[0], POLLIN, 0}};
+            alignas(struct inotify_event) char buffer[4096];
+
+            for (;;) {
+                if (poll(descriptors, 2, -1) < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return;
+                }
+                if (descriptors[1].revents != 0)
+                    return;
+
+                bool changed = false;
+                ssize_t length;
+                while ((length = ::read(m_inotify, buffer, sizeof(buffer))) > 0) {
+                    for (char *it = buffer; it < buffer + length;) {
+                        auto event = reinterpret_cast<const struct inotify_event *>(it);
+                        if (event->len != 0 && m_file_name == event->name)
+                            changed = true;
+                        it += sizeof(struct inotify_event) + event->len;
+                    }
+                }
+                if (changed)
+                    reload_and_notify();
+            }
+        }
+
+        void close_watch_descriptors() noexcept {
+            for (int *descriptor : {&m_inotify, &m_stop_pipe[0], &m_stop_pipe[1]}) {
+                if (*descriptor >= 0)
+                    ::close(*descriptor);
+                *descriptor = -1;
+            }
+        }
+#else
+        struct file_stamp {
+            bool exists;
+            std::uint64_t time;
+            std::uint64_t size;
+            std::uint64_t id;
+
+            bool operator==(const file_stamp &other) const noexcept {
+                return exists == other.exists && time == other.time && size == other.size && id == other.id;
+            }
+        };
+
+        static file_stamp stamp_file(const std::string &path) noexcept {
+#if (defined(_WIN32) || defined(_WIN64))
+            WIN32_FILE_ATTRIBUTE_DATA data;
+            if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data))
+                return file_stamp{false, 0, 0, 0};
+            return file_stamp{true,
+                (static_cast<std::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime,
+                (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow, 0};
+#else
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0)
+                return file_stamp{false, 0, 0, 0};
+            return file_stamp{true, static_cast<std::uint64_t>(info.st_mtime), static_cast<std::uint64_t>(info.st_size),
+                static_cast<std::uint64_t>(info.st_ino)};
+#endif
+        }
+
+        void watch_loop() noexcept {
+            std::unique_lock<std::mutex> lock(m_stop_mutex);
+            file_stamp last = stamp_file(m_path);
+
+            while (!m_stop_condition.wait_for(lock, std::chrono::milliseconds(250), [this] { return m_stop; })) {
+                const file_stamp current = stamp_file(m_path);
+                if (!current.exists || current == last)
+                    continue;
+                last = current;
+                lock.unlock();
+                reload_and_notify();
+                lock.lock();
+            }
+        }
+#endif
+    };
+
+    /**
+     *  One private instance of a dynamic library per NUMA node, so that the threads of each node
+     *  call code and touch data from local memory. On Linux each instance is loaded from its own
+     *  copy of the file (see load_options::isolated) while the memory policy of the loading thread
+     *  prefers the node, then its segments are prefaulted and bound to the node with mbind.
+     *  Elsewhere, a single isolated instance is loaded
+     */
+    class numa_library {
+    public:
+        /**
+         *  @brief Loads an instance of a dynamic library on every NUMA node
+         *
+         *  @throws dylib::load_error if an instance could not be loaded
+         *
+         *  @param dir_path the directory path where is located the dynamic library
+         *  @param lib_name the name of the dynamic library to load
+         *  @param decorations add os decorations to the library name
+         *  @param options the flags to load every instance with, on top of isolated and prefault_all
+         */
+        numa_library(const std::string &dir_path, const std::string &lib_name, bool decorations = add_filename_decorations,
+            load_options options = load_options::defaults) {
+            const std::string path = library_path(dir_path.c_str(), lib_name.c_str(), decorations);
+            const numa_topology &topology = system_topology();
+            m_cpu_nodes = topology.cpu_nodes;
+            m_nodes = topology.nodes;
+            for (int node : m_nodes)
+                m_instances.push_back(load_on_node(path, node, options));
+        }
+
+        /**
+         *  @return the number of instances, one per NUMA node
+         */
+        std::size_t size() const noexcept {
+            return m_instances.size();
+        }
+
+        /**
+         *  @return the instance of the given node index, from 0 to size() - 1
+         */
+        ///@{
+        dylib &instance(std::size_t index) {
+            if (index >= m_instances.size())
+                throw std::out_of_range("No NUMA node at index " + std::to_string(index));
+            return *m_instances[index];
+        }
+
+        const dylib &instance(std::size_t index) const {
+            return const_cast<numa_library *>(this)->instance(index);
+        }
+        ///@}
+
+        /**
+         *  @return the system number of the NUMA node of an instance, or -1 without NUMA support
+         */
+        int node(std::size_t index) const {
+            if (index >= m_nodes.size())
+                throw std::out_of_range("No NUMA node at index " + std::to_string(index));
+            return m_nodes[index];
+        }
+
+        /**
+         *  @return the index of the instance local to the node the calling thread runs on
+         */
+        std::size_t local_index() const noexcept {
+#if defined(__linux__)
+            const int cpu = sched_getcpu();
+            if (cpu >= 0 && static_cast<std::size_t>(cpu) < m_cpu_nodes.size())
+                return m_cpu_nodes[static_cast<std::size_t>(cpu)];
+#endif
+            return 0;
+        }
+
+        /**
+         *  @return the instance local to the node the calling thread runs on
+         */
+        ///@{
+        dylib &local() noexcept {
+            return *m_instances[local_index()];
+        }
+
+        const dylib &local() const noexcept {
+            return *m_instances[local_index()];
+        }
+        ///@}
+
+        /**
+         *  Get a function from the instance local to the node the calling thread runs on.
+         *  Threads that stay on a node should keep the returned pointer rather than calling it again
+         *
+         *  @throws dylib::symbol_error if the symbol could not be found
+         *
+         *  @param T the template argument must be the function prototype to get
+         *  @param symbol_name the symbol name of a function to get from the dynamic library
+         *
+         *  @return a pointer to the requested function of the local instance
+         */
+        ///@{
+        template<typename T>
+        T *get_function(const char *symbol_name) const {
+            return local().get_function<T>(symbol_name);
+        }
+
+        template<typename T>
+        T *get_function(const std::string &symbol_name) const {
+            return local().get_function<T>(symbol_name);
+        }
+        ///@}
+
+    private:
+        struct numa_topology {
+            std::vector<int> nodes{};
+            std::vector<std::size_t> cpu_nodes{};
+        };
+
+        std::vector<std::unique_ptr<dylib>> m_instances{};
+        std::vector<int> m_nodes{};
+        std::vector<std::size_t> m_cpu_nodes{};
+
+        static std::unique_ptr<dylib> load_on_node(const std::string &path, int node, load_options options) {
+            options = options | load_options::isolated;
+#if defined(__linux__) && defined(SYS_mbind)
+            if (node >= 0) {
+                // the pages of the copy and of the instance are allocated while the node is preferred
+                memory_policy preferred(node);
+                const auto copy = copy_library(path.c_str());
+                std::unique_ptr<dylib> lib(new dylib(copy->path.c_str(), no_filename_decorations,
+                    options | load_options::prefault_all));
+                preferred.bind(lib->m_handle);
+                return lib;
+            }
+#else
+            static_cast<void>(node);
+#endif
+            return std::unique_ptr<dylib>(new dylib(path.c_str(), no_filename_decorations, options));
+        }
+
+        static const numa_topology &system_topology() {
+            static const numa_topology topology = read_topology();
+            return topology;
+        }
+
+        static numa_topology read_topology() {
+            numa_topology topology;
+#if defined(__linux__)
+            for (int node : parse_list(read_text("/sys/devices/system/node/online"))) {
+                const std::size_t index = topology.nodes.size();
+                topology.nodes.push_back(node);
+                const std::string cpus = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+                for (int cpu : parse_list(read_text(cpus))) {
+                    if (static_cast<std::size_t>(cpu) >= topology.cpu_nodes.size())
+                        topology.cpu_nodes.resize(static_cast<std::size_t>(cpu) + 1, 0);
+                    topology.cpu_nodes[static_cast<std::size_t>(cpu)] = index;
+                }
+            }
+#endif
+            if (topology.nodes.empty())
+                topology.nodes.push_back(-1);
+            return topology;
+        }
+
+#if defined(__linux__)
+        static std::string read_text(const std::string &path) {
+            std::string text;
+            const int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (descriptor < 0)
+                return text;
+            char buffer[256];
+            ssize_t length;
+            while ((length = ::read(descriptor, buffer, sizeof(buffer))) > 0)
+                text.append(buffer, static_cast<std::size_t>(length));
+            ::close(descriptor);
+            return text;
+        }
+
+        // parses the "0-3,8,10-11" list format of sysfs
+        static std::vector<int> parse_list(const std::string &text) {
+            std::vector<int> values;
+            const char *cursor = text.c_str();
+            while (*cursor >= '0' && *cursor <= '9') {
+                char *end = nullptr;
+                const long first = std::strtol(cursor, &end, 10);
+                long last = first;
+                if (*end == '-')
+                    last = std::strtol(end + 1, &end, 10);
+                for (long value = first; value <= last && value < 65536; value++)
+                    values.push_back(static_cast<int>(value));
+                cursor = *end == ',' ? end + 1 : end;
+            }
+            return values;
+        }
+#endif
+
+#if defined(__linux__) && defined(SYS_mbind)
+        /**
+         *  Makes the calling thread prefer allocating memory on a node, restoring its previous
+         *  policy once destroyed. Failures are ignored, the placement being only an optimization
+         */
+        class memory_policy {
+        public:
+            explicit memory_policy(int node) noexcept {
+                if (node < 0 || static_cast<unsigned long>(node) >= max_nodes)
+                    return;
+                m_preferred[static_cast<std::size_t>(node) / bits] = 1ul << (static_cast<std::size_t>(node) % bits);
+                m_restore = syscall(SYS_get_mempolicy, &m_mode, m_previous, max_nodes, nullptr, 0ul) == 0;
+                m_applied = syscall(SYS_set_mempolicy, static_cast<long>(preferred), m_preferred, max_nodes) == 0;
+            }
+
+            memory_policy(const memory_policy&) = delete;
+            memory_policy& operator=(const memory_policy&) = delete;
+
+            ~memory_policy() {
+                if (!m_applied)
+                    return;
+                if (m_restore)
+                    syscall(SYS_set_mempolicy, static_cast<long>(m_mode), m_mode == 0 ? nullptr : m_previous, max_nodes);
+                else
+                    syscall(SYS_set_mempolicy, 0l, nullptr, 0ul);
+            }
+
+            /**
+             *  Bind the loaded segments of a library to the node, moving their pages already in memory
+             */
+            void bind(native_handle_type lib) const noexcept {
+                if (!m_applied)
+                    return;
+                std::vector<segment> loaded;
+                try {
+                    loaded = loaded_segments(lib);
+                } catch (const std::bad_alloc &) {
+                    return;
+                }
+                const std::uintptr_t page = page_size();
+                for (auto &area : loaded) {
+                    const std::uintptr_t begin = area.begin & ~(page - 1);
+                    const std::uintptr_t end = (area.begin + area.size + page - 1) & ~(page - 1);
+                    syscall(SYS_mbind, begin, end - begin, static_cast<long>(preferred), m_preferred, max_nodes,
+                        static_cast<unsigned long>(move_pages));
+                }
+            }
+
+        private:
+            // kernel ABI values of linux/mempolicy.h
+            static constexpr int preferred = 1;
+            static constexpr unsigned move_pages = 1u << 1;
+            static constexpr unsigned long max_nodes = 1024;
+            static constexpr std::size_t bits = 8 * sizeof(unsigned long);
+
+            int m_mode{0};
+            bool m_restore{false};
+            bool m_applied{false};
+            unsigned long m_previous[max_nodes / bits]{};
+            unsigned long m_preferred[max_nodes / bits]{};
+        };
+#endif
+    };
+
+#ifdef DYLIB_INSTRUMENTATION
+    /**
+     *  Receives the load, lookup and close events of every dynamic library of the process.
+     *  The events are delivered from non-throwing paths, so an exception thrown by a callback is ignored.
+     *  Only available when DYLIB_INSTRUMENTATION is defined before including dylib.hpp
+     */
+    class observer {
+    public:
+        virtual ~observer() = default;
+
+        /**
+         *  Invoked after a dynamic library was opened, or failed to open with a null handle
+         */
+        virtual void on_open(const char * /* path */, native_handle_type /* handle */,
+            std::chrono::nanoseconds /* elapsed */) {}
+
+        /**
+         *  Invoked after a symbol was looked up, the symbol being null if it was not found
+         */
+        virtual void on_lookup(native_handle_type /* handle */, const char * /* symbol_name */,
+            native_symbol_type /* symbol */, bool /* cache_hit */, std::chrono::nanoseconds /* elapsed */) {}
+
+        /**
+         *  Invoked after a dynamic library was closed
+         */
+        virtual void on_close(native_handle_type /* handle */, std::chrono::nanoseconds /* elapsed */) {}
+    };
+
+    /**
+     *  Install the observer of the process, or remove it with nullptr.
+     *  The observer must stay alive until it is removed
+     *
+     *  @param watcher the observer to notify
+     */
+    static void set_observer(observer *watcher) noexcept {
+        observer_slot().store(watcher, std::memory_order_release);
+    }
+
+    /**
+     *  The counters of a dynamic library, see get_statistics
+     */
+    struct statistics {
+        /** the path the library was loaded from */
+        std::string path;
+        /** the time spent opening the library */
+        std::chrono::nanoseconds load_time;
+        /** the time spent looking symbols up */
+        std::chrono::nanoseconds lookup_time;
+        /** the number of symbol lookups */
+        std::uint64_t lookups;
+        /** the number of lookups answered by the symbol cache */
+        std::uint64_t cache_hits;
+        /** the number of lookups of symbols that could not be found */
+        std::uint64_t misses;
+
+        /**
+         *  @return the ratio of lookups answered by the symbol cache, between 0 and 1
+         */
+        double cache_hit_ratio() const noexcept {
+            return lookups ? static_cast<double>(cache_hits) / static_cast<double>(lookups) : 0.0;
+        }
+    };
+
+    /**
+     *  @return the counters of the dynamic library currently loaded in the object.
+     *  Only available when DYLIB_INSTRUMENTATION is defined before including dylib.hpp
+     */
+    statistics get_statistics() const {
+        statistics stats{std::string(), std::chrono::nanoseconds(0), std::chrono::nanoseconds(0), 0, 0, 0};
+        if (!m_counters)
+            return stats;
+        stats.path = m_counters->path;
+        stats.load_time = m_counters->load_time;
+        stats.lookup_time = std::chrono::nanoseconds(m_counters->lookup_time.load(std::memory_order_relaxed));
+        stats.lookups = m_counters->lookups.load(std::memory_order_relaxed);
+        stats.cache_hits = m_counters->cache_hits.load(std::memory_order_relaxed);
+        stats.misses = m_counters->misses.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    /**
+     *  Write the counters of the dynamic library currently loaded in the object on a single line.
+     *  Only available when DYLIB_INSTRUMENTATION is defined before including dylib.hpp
+     *
+     *  @param out the stream to write to
+     */
+    void dump_statistics(std::ostream &out) const {
+        const statistics stats = get_statistics();
+        out << stats.path << ": load " << stats.load_time.count() << "ns, "
+            << stats.lookups << " lookups in " << stats.lookup_time.count() << "ns, "
+            << stats.cache_hits << " cache hits (" << stats.cache_hit_ratio() * 100 << "%), "
+            << stats.misses << " misses\n";
+    }
+#endif
+
+    /**
+     *  The segments of a loaded library to prefault, see prefault
+     */
+    enum class segments {
+        /** the executable segments, holding the code */
+        text,
+        /** every loaded segment */
+        all,
+    };
+
+    /**
+     *  Fault the pages of the dynamic library currently loaded in the object in ahead of use,
+     *  so the first calls into it do not stall on page faults, and optionally lock them in memory.
+     *  Locking is best effort: pages beyond the locking limit of the process are still prefaulted.
+     *  The prefault_text, prefault_all and lock_pages load options do the same right after loading
+     *
+     *  @throws std::logic_error if the dynamic library handle is null
+     *
+     *  @param which the segments to prefault
+     *  @param lock lock the prefaulted pages in memory (mlock, VirtualLock)
+     *
+     *  @return the number of bytes prefaulted
+     */
+    std::size_t prefault(segments which = segments::text, bool lock = false) const {
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+        return prefault_segments(m_handle, which, lock);
+    }
+
+    /**
+     *  Move the code of the dynamic library currently loaded in the object onto transparent huge pages,
+     *  to cut the instruction TLB misses of large libraries. Only the parts of the executable segments
+     *  aligned on huge pages can move, so the library must be linked with a huge page aligned code
+     *  segment (-Wl,-zcommon-page-size=2097152 -Wl,-zmax-page-size=2097152) for all of its code to move.
+     *  The remapped code is anonymous memory afterwards, so it is no longer shared between processes.
+     *  No other thread may run the code of the library during the remap.
+     *  Without transparent huge pages support, which is always the case outside of Linux, nothing is changed.
+     *  The huge_pages load option does the same right after loading
+     *
+     *  @throws std::logic_error if the dynamic library handle is null
+     *
+     *  @return the number of bytes remapped onto huge pages by this call
+     */
+    std::size_t remap_huge_pages() {
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+        const std::size_t remapped = remap_huge_pages(m_handle);
+        m_huge_page_bytes += remapped;
+        return remapped;
+    }
+
+    /**
+     *  @return the number of bytes of code of the dynamic library remapped onto huge pages
+     */
+    std::size_t huge_page_bytes() const noexcept {
+        return m_huge_page_bytes;
+    }
+
+    /**
+     *  @return the dynamic library handle
+     */
+    native_handle_type native_handle() noexcept {
+        return m_handle;
+    }
+
+protected:
+#if defined(__APPLE__)
+    /**
+     *  The parts of the Mach-O format read by the library, as laid out by <mach-o/loader.h>, <mach-o/fat.h> and <mach-o/nlist.h>
+     */
+    struct macho {
+        enum : std::uint32_t {
+            magic_64 = 0xfeedfacf,
+            fat_magic = 0xcafebabe,
+            lc_symtab = 0x2,
+            lc_dysymtab = 0xb,
+            lc_load_dylib = 0xc,
+            lc_load_weak_dylib = 0x18 | 0x80000000,
+            lc_segment_64 = 0x19,
+            lc_rpath = 0x1c | 0x80000000,
+            lc_reexport_dylib = 0x1f | 0x80000000,
+            lc_load_upward_dylib = 0x23 | 0x80000000,
+            n_ext = 0x01,
+            n_type_mask = 0x0e,
+            n_sect = 0x0e,
+            n_pext = 0x10,
+            n_stab = 0xe0
+        };
+        enum : std::int32_t { prot_none = 0, prot_read = 1, prot_execute = 4 };
+
+        struct header_64 {
+            std::uint32_t magic;
+            std::int32_t cputype;
+            std::int32_t cpusubtype;
+            std::uint32_t filetype;
+            std::uint32_t ncmds;
+            std::uint32_t sizeofcmds;
+            std::uint32_t flags;
+            std::uint32_t reserved;
+        };
+        struct load_command {
+            std::uint32_t cmd;
+            std::uint32_t cmdsize;
+        };
+        struct segment_command_64 {
+            std::uint32_t cmd;
+            std::uint32_t cmdsize;
+            char segname[16];
+            std::uint64_t vmaddr;
+            std::uint64_t vmsize;
+            std::uint64_t fileoff;
+            std::uint64_t filesize;
+            std::int32_t maxprot;
+            std::int32_t initprot;
+            std::uint32_t nsects;
+            std::uint32_t flags;
+        };
+        struct symtab_command {
+            std::uint32_t cmd;
+            std::uint32_t cmdsize;
+            std::uint32_t symoff;
+            std::uint32_t nsyms;
+            std::uint32_t stroff;
+            std::uint32_t strsize;
+        };
+        struct dysymtab_command {  // followed by more tables that are not read
+            std::uint32_t cmd;
+            std::uint32_t cmdsize;
+            std::uint32_t ilocalsym;
+            std::uint32_t nlocalsym;
+            std::uint32_t iextdefsym;
+            std::uint32_t nextdefsym;
+        };
+        struct nlist_64 {
+            union {
+                std::uint32_t n_strx;
+            } n_un;
+            std::uint8_t n_type;
+            std::uint8_t n_sect;
+            std::uint16_t n_desc;
+            std::uint64_t n_value;
+        };
+        struct fat_header {  // big endian
+            std::uint32_t magic;
+            std::uint32_t nfat_arch;
+        };
+        struct fat_arch {  // big endian
+            std::int32_t cputype;
+            std::int32_t cpusubtype;
+            std::uint32_t offset;
+            std::uint32_t size;
+            std::uint32_t align;
+        };
+    };
+
+    static_assert(sizeof(macho::header_64) == 32 && sizeof(macho::segment_command_64) == 72, "Unexpected Mach-O layout");
+    static_assert(sizeof(macho::nlist_64) == 16, "Unexpected Mach-O layout");
+#endif
+
+    dylib() noexcept = default;
+
+    /**
+     *  Schedules the libraries of a batch on the loading threads, following the load order
+     */
+    class batch_loader {
+    public:
+        batch_loader(const std::vector<std::string> &paths,
+            const std::vector<std::pair<std::size_t, std::size_t>> &order, load_options options)
+            : m_paths(paths), m_options(options), m_handles(paths.size(), nullptr), m_huge_page_bytes(paths.size(), 0),
+              m_errors(paths.size()), m_blockers(paths.size(), 0), m_dependents(paths.size()), m_remaining(paths.size()) {
+            for (auto &constraint : order) {
+                m_blockers[constraint.second]++;
+                m_dependents[constraint.first].push_back(constraint.second);
+            }
+            for (std::size_t i = 0; i < paths.size(); i++)
+                if (m_blockers[i] == 0)
+                    m_ready.push_back(i);
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_remaining > 0) {
+                if (m_ready.empty()) {
+                    if (m_loading == 0) {
+                        fail_circular();
+                        break;
+                    }
+                    m_update.wait(lock);
+                    continue;
+                }
+                const std::size_t index = m_ready.back();
+                m_ready.pop_back();
+                m_loading++;
+
+                lock.unlock();
+                std::string error;
+#ifdef DYLIB_INSTRUMENTATION
+                auto handle = open_observed(m_paths[index].c_str(), m_options, m_load_times[index]);
+#else
+                auto handle = open(m_paths[index].c_str(), m_options);
+#endif
+                if (handle)
+                    m_huge_page_bytes[index] = prepare_pages(handle, m_options);
+                else
+                    error = "Could not load library \"" + m_paths[index] + "\"\n" + get_error_description();
+                lock.lock();
+
+                m_loading--;
+                if (handle)
+                    m_handles[index] = handle;
+                else
+                    fail(index, std::move(error));
+                finish(index);
+                m_update.notify_all();
+            }
+        }
+
+        load_result result() {
+            load_result batch{std::vector<dylib>(), std::vector<load_failure>()};
+            batch.libraries.reserve(m_paths.size());
+            for (std::size_t i = 0; i < m_paths.size(); i++) {
+                dylib lib;
+                lib.m_handle = m_handles[i];
+                lib.m_huge_page_bytes = m_huge_page_bytes[i];
+                lib.m_deferred_close = has_option(m_options, load_options::deferred_close);
+                m_handles[i] = nullptr;
+#ifdef DYLIB_INSTRUMENTATION
+                if (lib.m_handle)
+                    lib.record_load(m_paths[i].c_str(), m_load_times[i]);
+#endif
+                batch.libraries.push_back(std::move(lib));
+                if (!m_errors[i].empty())
+                    batch.errors.push_back(load_failure{i, m_paths[i], load_error(m_errors[i])});
+            }
+            return batch;
+        }
+
+        ~batch_loader() {
+            for (auto handle : m_handles)
+                if (handle)
+                    close(handle);
+        }
+
+    private:
+        const std::vector<std::string> &m_paths;
+        const load_options m_options;
+        std::vector<native_handle_type> m_handles;
+        std::vector<std::size_t> m_huge_page_bytes;
+        std::vector<std::string> m_errors;
+        std::vector<std::size_t> m_blockers;
+        std::vector<std::vector<std::size_t>> m_dependents;
+        std::vector<std::size_t> m_ready{};
+        std::size_t m_remaining;
+        std::size_t m_loading{0};
+        std::vector<std::chrono::nanoseconds> m_load_times = std::vector<std::chrono::nanoseconds>(m_paths.size());
+        std::mutex m_mutex{};
+        std::condition_variable m_update{};
+
+        void fail(std::size_t index, std::string &&error) {
+            m_errors[index] = std::move(error);
+        }
+
+        void finish(std::size_t index) {
+            m_remaining--;
+            for (auto dependent : m_dependents[index]) {
+                if (!m_errors[index].empty() && m_errors[dependent].empty())
+                    m_errors[dependent] = "Could not load library \"" + m_paths[dependent] + "\"\nLibrary \"" +
+                        m_paths[index] + "\" required before it could not be loaded";
+                if (--m_blockers[dependent] != 0)
+                    continue;
+                if (m_errors[dependent].empty())
+                    m_ready.push_back(dependent);
+                else
+                    finish(dependent);
+            }
+        }
+
+        void fail_circular() {
+            for (std::size_t i = 0; i < m_paths.size(); i++)
+                if (m_blockers[i] != 0 && m_errors[i].empty())
+                    m_errors[i] = "Could not load library \"" + m_paths[i] + "\"\nCircular load order";
+            m_remaining = 0;
+            m_update.notify_all();
+        }
+    };
+
+    static void run_batch(batch_loader &batch, unsigned threads, std::size_t size) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<std::size_t>(threads, size));
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back([&batch]() { batch.run(); });
+        batch.run();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    static dylib load_and_preload(const std::string &dir_path, const std::string &lib_name,
+        const std::vector<std::string> &symbols, bool decorations, load_options options) {
+        dylib lib(dir_path, lib_name, decorations, options);
+        if (!symbols.empty())
+            lib.preload_symbols(symbols);
+        return lib;
+    }
+
+    /**
+     *  @return true if a background thread was already ended by ExitProcess, which kills the other
+     *  threads before the static destructors of the DLLs run, possibly while they hold a lock
+     */
+    static bool worker_ended(std::thread &thread) noexcept {
+#if defined(_MSC_VER)
+        return thread.joinable() && WaitForSingleObject(thread.native_handle(), 0) == WAIT_OBJECT_0;
+#else
+        static_cast<void>(thread);
+        return false;
+#endif
+    }
+
+    /**
+     *  Waits for a background thread asked to stop, from the destructor of its static owner.
+     *  On Windows the end of a thread waits for the loader lock, which is held while the static
+     *  destructors of a DLL run when it is unloaded, so the thread is detached once its loop is
+     *  over, as reported by finished, instead of being joined
+     */
+    static void stop_worker(std::thread &thread, std::unique_lock<std::mutex> &lock, std::condition_variable &done,
+        const bool &finished) {
+        if (!thread.joinable())
+            return;
+#if (defined(_WIN32) || defined(_WIN64))
+        done.wait(lock, [&finished]() { return finished; });
+        thread.detach();
+#else
+        static_cast<void>(done);
+        static_cast<void>(finished);
+        lock.unlock();
+        thread.join();
+#endif
+    }
+
+    /**
+     *  Background thread running the callback loads of load_async in call order. The thread is
+     *  started by the first load, and stopped when the process exits once the queued loads are done
+     */
+    class async_loader {
+    public:
+        async_loader() {
+            state().store(running, std::memory_order_release);
+        }
+
+        async_loader(const async_loader&) = delete;
+        async_loader& operator=(const async_loader&) = delete;
+
+        ~async_loader() {
+            state().store(destroyed, std::memory_order_release);
+            if (worker_ended(m_thread)) {
+                m_thread.join();
+                return;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_wake.notify_one();
+            stop_worker(m_thread, lock, m_done, m_finished);
+        }
+
+        /**
+         *  @return false if the job could not be queued and must be run by the caller
+         */
+        static bool push(const std::function<void()> &job) {
+            if (state().load(std::memory_order_acquire) == destroyed)
+                return false;  // during static destruction
+            static async_loader global_loader;
+            {
+                std::lock_guard<std::mutex> lock(global_loader.m_mutex);
+                if (global_loader.m_stopping)
+                    return false;
+                if (!global_loader.m_thread.joinable())
+                    global_loader.m_thread = std::thread(&async_loader::run, &global_loader);
+                global_loader.m_jobs.push_back(job);
+            }
+            global_loader.m_wake.notify_one();
+            return true;
+        }
+
+    private:
+        std::mutex m_mutex{};
+        std::condition_variable m_wake{};
+        std::condition_variable m_done{};
+        std::vector<std::function<void()>> m_jobs{};
+        std::size_t m_next{0};
+        bool m_stopping{false};
+        bool m_finished{false};
+        std::thread m_thread{};
+
+        enum lifetime { unused, running, destroyed };
+
+        // trivially destructible, so it can still be read once the loader itself is destroyed
+        static std::atomic<int> &state() noexcept {
+            static std::atomic<int> current{unused};
+            return current;
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;) {
+                m_wake.wait(lock, [this]() { return m_stopping || m_next < m_jobs.size(); });
+                if (m_next == m_jobs.size()) {  // stopping, once every queued load is done
+                    m_finished = true;
+                    m_done.notify_all();
+                    return;
+                }
+                std::function<void()> job = std::move(m_jobs[m_next++]);
+                if (m_next == m_jobs.size()) {
+                    m_jobs.clear();
+                    m_next = 0;
+                }
+                lock.unlock();
+                job();
+                lock.lock();
+            }
+        }
+    };
+
+    static void prefetch_file(const char *path) noexcept {
+#if defined(POSIX_FADV_WILLNEED)
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        ::close(fd);
+#else
+        (void)path;
+#endif
+    }
+
+    /**
+     *  Open addressing hash table mapping symbol names to resolved symbols.
+     *  Lookups take a raw C string, so probing the cache never allocates.
+     *  Readers never lock: entries are immutable once published, and a full table is replaced
+     *  by a larger copy while the retired ones are kept until the cache is destroyed, so a
+     *  concurrent reader can always finish its probe. Insertions are serialized by a mutex
+     */
+    class symbol_cache {
+    public:
+        symbol_cache() = default;
+        symbol_cache(const symbol_cache&) = delete;
+        symbol_cache& operator=(const symbol_cache&) = delete;
+
+        native_symbol_type find(const char *name, std::uint64_t hash) const noexcept {
+            return find(name, std::strlen(name), hash);
+        }
+
+        native_symbol_type find(const char *name, std::size_t length, std::uint64_t hash) const noexcept {
+            const table *current = m_table.load(std::memory_order_acquire);
+            return current ? probe(*current, name, length, hash) : nullptr;
+        }
+
+        void insert(const char *name, std::uint64_t hash, native_symbol_type symbol) noexcept {
+            const std::size_t length = std::strlen(name);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            table *current = m_table.load(std::memory_order_relaxed);
+            if (current && probe(*current, name, length, hash) != nullptr)
+                return;
+            try {
+                std::unique_ptr<entry> item(new entry{hash, std::string(name, length), symbol});
+                if (m_entries.size() == m_entries.capacity())
+                    m_entries.reserve(m_entries.size() * 2 + 16);
+                if (!current || (m_entries.size() + 1) * 2 > current->capacity)
+                    current = grow(current ? current->capacity * 2 : 16);
+                place(*current, item.get());
+                m_entries.push_back(std::move(item));
+            } catch (const std::bad_alloc &) {
+                // the cache is only an accelerator, the symbol stays resolvable without it
+            }
+        }
+
+    private:
+        struct entry {
+            std::uint64_t hash;
+            std::string name;
+            native_symbol_type symbol;
+        };
+
+        struct table {
+            explicit table(std::size_t size) : capacity(size), slots(new std::atomic<const entry *>[size]()) {}
+
+            std::size_t capacity;
+            std::unique_ptr<std::atomic<const entry *>[]> slots;
+        };
+
+        std::mutex m_mutex{};
+        std::atomic<table *> m_table{nullptr};
+        std::vector<std::unique_ptr<table>> m_tables{};
+        std::vector<std::unique_ptr<entry>> m_entries{};
+
+        static native_symbol_type probe(const table &slots, const char *name, std::size_t length,
+            std::uint64_t hash) noexcept {
+            const std::size_t mask = slots.capacity - 1;
+            for (std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask) {
+                const entry *slot = slots.slots[i].load(std::memory_order_acquire);
+                if (slot == nullptr)
+                    return nullptr;
+                if (slot->hash == hash && slot->name.size() == length && std::memcmp(slot->name.data(), name, length) == 0)
+                    return slot->symbol;
+            }
+        }
+
+        static void place(table &slots, const entry *item) noexcept {
+            const std::size_t mask = slots.capacity - 1;
+            std::size_t i = static_cast<std::size_t>(item->hash) & mask;
+            while (slots.slots[i].load(std::memory_order_relaxed) != nullptr)
+                i = (i + 1) & mask;
+            slots.slots[i].store(item, std::memory_order_release);
+        }
+
+        table *grow(std::size_t capacity) {
+            m_tables.reserve(m_tables.size() + 1);
+            std::unique_ptr<table> larger(new table(capacity));
+            for (auto &item : m_entries)
+                place(*larger, item.get());
+            m_tables.push_back(std::move(larger));
+            m_table.store(m_tables.back().get(), std::memory_order_release);
+            return m_tables.back().get();
+        }
+    };
+
+    /**
+     *  Background thread closing the libraries loaded with load_options::deferred_close, once their
+     *  grace period is over. Destroying such a library only queues its handle. The thread is started
+     *  by the first deferred close, and closes whatever is still pending when the process exits
+     */
+    class reaper {
+    public:
+        reaper() {
+            state().store(running, std::memory_order_release);
+        }
+
+        reaper(const reaper&) = delete;
+        reaper& operator=(const reaper&) = delete;
+
+        ~reaper() {
+            state().store(destroyed, std::memory_order_release);
+            if (worker_ended(m_thread)) {
+                m_thread.join();
+                return;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_wake.notify_one();
+            stop_worker(m_thread, lock, m_idle, m_finished);
+        }
+
+        static reaper &instance() {
+            static reaper global_reaper;
+            return global_reaper;
+        }
+
+        /**
+         *  @return false if the handle could not be queued and must be closed by the caller
+         */
+        static bool push(native_handle_type handle) noexcept {
+            if (state().load(std::memory_order_acquire) == destroyed)
+                return false;  // during static destruction
+            try {
+                reaper &self = instance();
+                std::lock_guard<std::mutex> lock(self.m_mutex);
+                if (self.m_stopping)
+                    return false;
+                if (!self.m_thread.joinable())
+                    self.m_thread = std::thread(&reaper::run, &self);
+                self.m_pending.push_back(pending_close{handle, std::chrono::steady_clock::now() + self.m_delay});
+            } catch (...) {
+                return false;
+            }
+            instance().m_wake.notify_one();
+            return true;
+        }
+
+        void set_delay(std::chrono::milliseconds delay) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_delay = delay;
+        }
+
+        std::size_t pending() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_pending.size() + m_closing;
+        }
+
+        void flush() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_thread.joinable() || m_thread.get_id() == std::this_thread::get_id())
+                return;
+            m_flushes++;
+            m_wake.notify_one();
+            m_idle.wait(lock, [this]() { return m_pending.empty() && m_closing == 0; });
+            m_flushes--;
+        }
+
+    private:
+        struct pending_close {
+            native_handle_type handle;
+            std::chrono::steady_clock::time_point due;
+        };
+
+        std::mutex m_mutex{};
+        std::condition_variable m_wake{};
+        std::condition_variable m_idle{};
+        std::vector<pending_close> m_pending{};
+        std::vector<native_handle_type> m_batch{};
+        std::chrono::milliseconds m_delay{0};
+        std::size_t m_closing{0};
+        std::size_t m_flushes{0};
+        bool m_stopping{false};
+        bool m_finished{false};
+        std::thread m_thread{};
+
+        enum lifetime { unused, running, destroyed };
+
+        // trivially destructible, so it can still be read once the reaper itself is destroyed
+        static std::atomic<int> &state() noexcept {
+            static std::atomic<int> current{unused};
+            return current;
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;) {
+                const auto now = std::chrono::steady_clock::now();
+                auto next = std::chrono::steady_clock::time_point::max();
+                for (std::size_t i = 0; i < m_pending.size();) {
+                    if (m_stopping || m_flushes != 0 || m_pending[i].due <= now) {
+                        m_batch.push_back(m_pending[i].handle);
+                        m_pending[i] = m_pending.back();
+                        m_pending.pop_back();
+                    } else {
+                        next = std::min(next, m_pending[i++].due);
+                    }
+                }
+
+                if (!m_batch.empty()) {
+                    m_closing = m_batch.size();
+                    std::vector<native_handle_type> batch;
+                    batch.swap(m_batch);
+                    lock.unlock();
+                    for (auto handle : batch)
+                        close_observed(handle);
+                    batch.clear();
+                    lock.lock();
+                    m_batch.swap(batch);
+                    m_closing = 0;
+                    m_idle.notify_all();
+                    continue;
+                }
+                if (m_stopping) {
+                    m_finished = true;
+                    m_idle.notify_all();
+                    return;
+                }
+                if (next == std::chrono::steady_clock::time_point::max())
+                    m_wake.wait(lock);
+                else
+                    m_wake.wait_until(lock, next);
+            }
+        }
+    };
+
+    /**
+     *  Keeps the file a library image was loaded from alive, then removes it once the library is closed
+     */
+    struct image_backing {
+        int descriptor{-1};
+        std::string path{};
+
+        image_backing() = default;
+        image_backing(const image_backing&) = delete;
+        image_backing& operator=(const image_backing&) = delete;
+
+        ~image_backing() {
+#if !(defined(_WIN32) || defined(_WIN64))
+            if (descriptor >= 0)
+                ::close(descriptor);
+#endif
+            if (!path.empty())
+                std::remove(path.c_str());
+        }
+    };
+
+    native_handle_type m_handle{nullptr};
+    mutable std::unique_ptr<symbol_cache> m_symbol_cache{};
+    std::unique_ptr<image_backing> m_backing{};
+    std::size_t m_huge_page_bytes{0};
+    bool m_deferred_close{false};
+
+    struct profiler_registry {
+        std::mutex mutex{};
+        std::unordered_map<const void *, std::weak_ptr<call_profiler>> profilers{};
+    };
+
+    static std::atomic<bool> &profiling_slot() noexcept {
+        static std::atomic<bool> enabled{false};
+        return enabled;
+    }
+
+    static profiler_registry &profilers_of_process() {
+        static profiler_registry registry;
+        return registry;
+    }
+
+    static std::shared_ptr<call_profiler> profiler_of(const void *function, const char *symbol_name) {
+        profiler_registry &registry = profilers_of_process();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto &slot = registry.profilers[function];
+        auto profiler = slot.lock();
+        if (profiler)
+            return profiler;
+        for (auto it = registry.profilers.begin(); it != registry.profilers.end();) {
+            if (it->second.expired() && it->first != function)
+                it = registry.profilers.erase(it);
+            else
+                ++it;
+        }
+        profiler.reset(new call_profiler(symbol_name));
+        registry.profilers[function] = profiler;
+        return profiler;
+    }
+
+    static std::uint64_t read_ticks() noexcept {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+        return __builtin_ia32_rdtsc();
+#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER)
+        return __rdtsc();
+#elif defined(__aarch64__) && defined(__GNUC__)
+        std::uint64_t ticks;
+        __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     *  @return the duration of a tick of read_ticks in nanoseconds, measured once against the steady clock
+     *  for the time stamp counter of x86
      */
-    native_handle_type native_handle() noexcept {
-        return m_handle;
+    static double tick_period() noexcept {
+        static const double period = measure_tick_period();
+        return period;
     }
 
-protected:
-    native_handle_type m_handle{nullptr};
+    static double measure_tick_period() noexcept {
+#if ((defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)) || ((defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER))
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t start_ticks = read_ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const std::uint64_t ticks = read_ticks() - start_ticks;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        return ticks ? static_cast<double>(elapsed.count()) / static_cast<double>(ticks) : 1.0;
+#elif defined(__aarch64__) && defined(__GNUC__)
+        std::uint64_t frequency;
+        __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+        return frequency ? 1e9 / static_cast<double>(frequency) : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+
+    // declared whether or not DYLIB_INSTRUMENTATION is defined, so that the layout of the class
+    // does not depend on it and translation units built with and without it can be linked together
+    struct counters {
+        std::string path{};
+        std::chrono::nanoseconds load_time{0};
+        std::atomic<std::uint64_t> lookup_time{0};
+        std::atomic<std::uint64_t> lookups{0};
+        std::atomic<std::uint64_t> cache_hits{0};
+        std::atomic<std::uint64_t> misses{0};
+    };
+
+    std::unique_ptr<counters> m_counters{};
+
+#ifdef DYLIB_INSTRUMENTATION
+    static std::atomic<observer *> &observer_slot() noexcept {
+        static std::atomic<observer *> slot{nullptr};
+        return slot;
+    }
+
+    static native_handle_type open_observed(const char *path, load_options options, std::chrono::nanoseconds &elapsed) {
+        const auto start = std::chrono::steady_clock::now();
+        auto handle = open(path, options);
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        auto watcher = observer_slot().load(std::memory_order_acquire);
+        if (watcher) {
+            try {
+                watcher->on_open(path, handle, elapsed);
+            } catch (...) {}
+        }
+        return handle;
+    }
+
+    void record_load(const char *path, std::chrono::nanoseconds load_time) {
+        if (!m_counters)
+            m_counters.reset(new counters());
+        m_counters->path = path;
+        m_counters->load_time = load_time;
+    }
+#endif
+
+    /**
+     *  A null terminated path composed in a fixed stack buffer,
+     *  only falling back to the heap for oversized paths
+     */
+    class path_buffer {
+    public:
+        path_buffer() noexcept {
+            m_inline[0] = '\0';
+        }
+
+        path_buffer(const path_buffer&) = delete;
+        path_buffer& operator=(const path_buffer&) = delete;
+
+        void append(const char *data, std::size_t length) {
+            if (m_size + length + 1 > m_capacity) {
+                const std::size_t capacity = std::max(m_capacity * 2, m_size + length + 1);
+                std::unique_ptr<char[]> heap(new char[capacity]);
+                std::memcpy(heap.get(), m_data, m_size + 1);
+                m_heap = std::move(heap);
+                m_data = m_heap.get();
+                m_capacity = capacity;
+            }
+            std::memcpy(m_data + m_size, data, length);
+            m_size += length;
+            m_data[m_size] = '\0';
+        }
+
+        void append(const char *data) {
+            append(data, std::strlen(data));
+        }
+
+        const char *c_str() const noexcept {
+            return m_data;
+        }
+
+        std::size_t size() const noexcept {
+            return m_size;
+        }
+
+    private:
+        static constexpr std::size_t inline_capacity = 256;
+
+        char m_inline[inline_capacity];
+        std::unique_ptr<char[]> m_heap{};
+        char *m_data{m_inline};
+        std::size_t m_size{0};
+        std::size_t m_capacity{inline_capacity};
+    };
+
+    static void compose_path(path_buffer &path, const char *dir_path, std::size_t dir_length,
+        const char *lib_name, std::size_t name_length, bool decorations) {
+        path.append(dir_path, dir_length);
+        if (dir_length != 0 && dir_path[dir_length - 1] != '/')
+            path.append("/", 1);
+        if (decorations)
+            path.append(filename_components::prefix);
+        path.append(lib_name, name_length);
+        if (decorations)
+            path.append(filename_components::suffix);
+    }
+
+    static std::string library_path(const char *dir_path, const char *lib_name, bool decorations) {
+        path_buffer path;
+        compose_path(path, dir_path, std::strlen(dir_path), lib_name, std::strlen(lib_name), decorations);
+        return std::string(path.c_str(), path.size());
+    }
+
+    void load_library(const char *dir_path, std::size_t dir_length, const char *lib_name, std::size_t name_length,
+        bool decorations, load_options options) {
+        path_buffer path;
+        compose_path(path, dir_path, dir_length, lib_name, name_length, decorations);
+        load_path(path.c_str(), options);
+    }
+
+    void load_path(const char *path, load_options options) {
+        std::unique_ptr<image_backing> copy;
+#ifndef DYLIB_DLMOPEN
+        // without private namespaces, the loader only hands out a new instance for a new file
+        if (has_option(options, load_options::isolated))
+            copy = copy_library(path);
+#endif
+        m_handle = open_path(copy ? copy->path.c_str() : path, options);
+#ifdef DYLIB_DLMOPEN
+        // glibc only has a few private namespaces (16), each with its own libc taking static TLS space:
+        // once either runs out the next instances are private copies, other errors are reported as is
+        if (!m_handle && has_option(options, load_options::isolated)) {
+            const std::string description = get_error_description();
+            if (description.find("no more namespaces") == std::string::npos &&
+                description.find("static TLS") == std::string::npos)
+                throw load_error("Could not load library \"" + std::string(path) + "\"\n" + description);
+            copy = copy_library(path);
+            m_handle = open_path(copy->path.c_str(), static_cast<load_options>(
+                static_cast<unsigned>(options) & ~static_cast<unsigned>(load_options::isolated)));
+            if (!m_handle)
+                throw load_error("Could not load library \"" + std::string(path) + "\"\n" + description);
+        }
+#endif
+
+        if (!m_handle)
+            throw load_error("Could not load library \"" + std::string(path) + "\"\n" + get_error_description());
+        m_huge_page_bytes = prepare_pages(m_handle, options);
+        m_deferred_close = has_option(options, load_options::deferred_close);
+        // a loaded DLL cannot be deleted, the copy is removed once the library is closed
+        if (copy)
+            DYLIB_WIN_OTHER(m_backing = std::move(copy), copy.reset());
+    }
+
+    native_handle_type open_path(const char *path, load_options options) {
+#ifdef DYLIB_INSTRUMENTATION
+        std::chrono::nanoseconds load_time;
+        auto handle = open_observed(path, options, load_time);
+        if (handle)
+            record_load(path, load_time);
+        return handle;
+#else
+        return open(path, options);
+#endif
+    }
+
+    static std::unique_ptr<image_backing> copy_library(const char *path) {
+        std::unique_ptr<image_backing> copy(new image_backing());
+        copy->path = unique_copy_path(path);
+        if (!copy_file(path, copy->path))
+            throw load_error("Could not load library \"" + std::string(path) + "\"\nCould not copy it to \"" +
+                copy->path + "\"");
+        return copy;
+    }
+
+    void load_image(const memory_view &image, load_options options) {
+#ifndef DYLIB_DLMOPEN
+        // every image is loaded from a file of its own, which already makes it a private instance
+        options = static_cast<load_options>(static_cast<unsigned>(options) & ~static_cast<unsigned>(load_options::isolated));
+#endif
+        std::unique_ptr<image_backing> backing(new image_backing());
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+        // the descriptor stays open while the library is loaded, otherwise a later image could reuse
+        // its number, and the loader would hand back this library for the same /proc/self/fd path
+        backing->descriptor = memfd_create("dylib", MFD_CLOEXEC);
+        if (backing->descriptor >= 0) {
+            if (!write_all(backing->descriptor, image.data, image.size))
+                throw load_error("Could not load library from memory\n" + std::string(std::strerror(errno)));
+            load_path(("/proc/self/fd/" + std::to_string(backing->descriptor)).c_str(), options);
+            m_backing = std::move(backing);
+            return;
+        }
+#endif
+        backing->path = write_temporary_file(image);
+        load_path(backing->path.c_str(), options);
+        // a loaded DLL cannot be deleted, the file is removed once the library is closed, while
+        // elsewhere the mapped image outlives the file, removed right away with the backing
+        DYLIB_WIN_OTHER(m_backing = std::move(backing), backing.reset());
+    }
+
+    static std::string write_temporary_file(const memory_view &image) {
+#if (defined(_WIN32) || defined(_WIN64))
+        char directory[MAX_PATH];
+        char path[MAX_PATH];
+        if (!GetTempPathA(MAX_PATH, directory) || !GetTempFileNameA(directory, "dyl", 0, path))
+            throw load_error("Could not load library from memory\n" + get_error_description());
+
+        HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+        bool written = file != INVALID_HANDLE_VALUE;
+        const char *data = static_cast<const char *>(image.data);
+        for (std::size_t offset = 0; written && offset < image.size;) {
+            DWORD count = 0;
+            const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(image.size - offset, 1u << 30));
+            written = WriteFile(file, data + offset, chunk, &count, nullptr) != 0;
+            offset += count;
+        }
+        const std::string description = written ? std::string() : get_error_description();
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        if (!written) {
+            DeleteFileA(path);
+            throw load_error("Could not load library from memory\n" + description);
+        }
+        return path;
+#else
+        std::string path = temporary_directory() + "dylib-XXXXXX";
+        const int descriptor = mkstemp(&path[0]);
+        if (descriptor < 0)
+            throw load_error("Could not load library from memory\n" + std::string(std::strerror(errno)));
+
+        const bool written = write_all(descriptor, image.data, image.size);
+        const int error = errno;
+        ::close(descriptor);
+        if (!written) {
+            ::unlink(path.c_str());
+            throw load_error("Could not load library from memory\n" + std::string(std::strerror(error)));
+        }
+        return path;
+#endif
+    }
+
+#if !(defined(_WIN32) || defined(_WIN64))
+    static bool write_all(int descriptor, const void *data, std::size_t size) noexcept {
+        const char *bytes = static_cast<const char *>(data);
+        while (size != 0) {
+            const ssize_t count = ::write(descriptor, bytes, size);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            bytes += count;
+            size -= static_cast<std::size_t>(count);
+        }
+        return true;
+    }
+#endif
+
+    // the copies go to the temporary directory, since the directory of the library may be read-only
+    static std::string unique_copy_path(const std::string &path) {
+        static std::atomic<std::uint64_t> counter{0};
+        const std::size_t separator = path.find_last_of(DYLIB_WIN_OTHER("/\\", "/"));
+        return temporary_directory() + (separator == std::string::npos ? path : path.substr(separator + 1)) + "." +
+            std::to_string(DYLIB_WIN_OTHER(GetCurrentProcessId, getpid)()) + "." + std::to_string(++counter) +
+            filename_components::suffix;
+    }
+
+    static std::string temporary_directory() {
+#if (defined(_WIN32) || defined(_WIN64))
+        char directory[MAX_PATH];
+        const DWORD length = GetTempPathA(MAX_PATH, directory);
+        return length != 0 && length < MAX_PATH ? std::string(directory, length) : std::string(".\\");
+#else
+        const char *directory = std::getenv("TMPDIR");
+        return std::string(directory && directory[0] ? directory : "/tmp") + "/";
+#endif
+    }
+
+    static bool copy_file(const std::string &from, const std::string &to) noexcept {
+#if (defined(_WIN32) || defined(_WIN64))
+        return CopyFileA(from.c_str(), to.c_str(), TRUE) != 0;
+#else
+        const int input = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+        if (input < 0)
+            return false;
+        const int output = ::open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0700);
+        bool copied = output >= 0;
+        char buffer[16384];
+        while (copied) {
+            const ssize_t length = ::read(input, buffer, sizeof(buffer));
+            if (length == 0)
+                break;
+            if (length < 0)
+                copied = errno == EINTR;
+            else
+                copied = write_all(output, buffer, static_cast<std::size_t>(length));
+        }
+        ::close(input);
+        if (output >= 0 && ::close(output) != 0)
+            copied = false;
+        if (!copied && output >= 0)
+            ::unlink(to.c_str());
+        return copied;
+#endif
+    }
+
+    static std::string canonical_path(const std::string &path) {
+#if (defined(_WIN32) || defined(_WIN64))
+        char buffer[MAX_PATH];
+        const DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, buffer, nullptr);
+        if (length == 0 || length >= MAX_PATH)
+            return path;
+        return std::string(buffer, length);
+#else
+        std::unique_ptr<char, void (*)(void *)> resolved(realpath(path.c_str(), nullptr), std::free);
+        return resolved ? std::string(resolved.get()) : path;
+#endif
+    }
+
+    static std::uint64_t hash_symbol_name(const char *name) noexcept {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (; *name; name++)
+            hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ULL;
+        return hash;
+    }
+
+    native_symbol_type resolve_symbol(const char *name, const char *version = nullptr,
+        const symbol_key *key = nullptr) const noexcept {
+#ifdef DYLIB_INSTRUMENTATION
+        const auto start = std::chrono::steady_clock::now();
+        bool cache_hit = false;
+        auto symbol = version ? locate_versioned_symbol(name, version, &cache_hit)
+                              : m_symbol_cache ? locate_cached_symbol(name, key, &cache_hit) : locate_symbol(m_handle, name);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        if (m_counters) {
+            m_counters->lookups.fetch_add(1, std::memory_order_relaxed);
+            m_counters->lookup_time.fetch_add(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), std::memory_order_relaxed);
+            if (cache_hit)
+                m_counters->cache_hits.fetch_add(1, std::memory_order_relaxed);
+            if (symbol == nullptr)
+                m_counters->misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto watcher = observer_slot().load(std::memory_order_acquire);
+        if (watcher) {
+            try {
+                watcher->on_lookup(m_handle, name, symbol, cache_hit, elapsed);
+            } catch (...) {}
+        }
+        return symbol;
+#else
+        if (version)
+            return locate_versioned_symbol(name, version);
+        return m_symbol_cache ? locate_cached_symbol(name, key) : locate_symbol(m_handle, name);
+#endif
+    }
+
+    template<typename T>
+    static T *function_cast(native_symbol_type symbol) noexcept {
+#if (defined(__GNUC__) && __GNUC__ >= 8)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-function-type"
+#endif
+        return reinterpret_cast<T *>(symbol);
+#if (defined(__GNUC__) && __GNUC__ >= 8)
+#pragma GCC diagnostic pop
+#endif
+    }
+
+    template<typename Table, typename Bindings>
+    Table bind_table(const Bindings &bindings) const {
+        if (!m_handle)
+            throw std::logic_error("The dynamic library handle is null");
+
+        Table table{};
+        std::string missing;
+        std::string descriptions;
+
+        bind_entries<0>(table, bindings, missing, descriptions);
+        if (!missing.empty())
+            throw symbol_error("Could not get symbols " + missing + "\n" + descriptions);
+        return table;
+    }
+
+    template<std::size_t I, typename Table, typename Bindings>
+    typename std::enable_if<I == std::tuple_size<Bindings>::value>::type
+    bind_entries(Table &, const Bindings &, std::string &, std::string &) const {}
+
+    template<std::size_t I, typename Table, typename Bindings>
+    typename std::enable_if<I < std::tuple_size<Bindings>::value>::type
+    bind_entries(Table &table, const Bindings &bindings, std::string &missing, std::string &descriptions) const {
+        bind_entry(table, std::get<I>(bindings), missing, descriptions);
+        bind_entries<I + 1>(table, bindings, missing, descriptions);
+    }
+
+    template<typename Table, typename T>
+    void bind_entry(Table &table, const binding<Table, T> &entry, std::string &missing, std::string &descriptions) const {
+        if (!entry.name)
+            throw std::invalid_argument("Null parameter");
+
+        auto symbol = resolve_symbol(entry.name);
+        if (symbol == nullptr) {
+            missing += (missing.empty() ? "\"" : ", \"") + std::string(entry.name) + "\"";
+            descriptions += (descriptions.empty() ? "" : "\n") + lookup_error_description();
+        }
+        table.*(entry.member) = function_cast<T>(symbol);
+    }
+
+    native_symbol_type locate_cached_symbol(const char *name, const symbol_key *key,
+        bool *cache_hit = nullptr) const noexcept {
+        const std::uint64_t hash = key ? key->hash() : hash_symbol_name(name);
+        auto symbol = key ? m_symbol_cache->find(name, key->size(), hash) : m_symbol_cache->find(name, hash);
+        if (cache_hit)
+            *cache_hit = symbol != nullptr;
+        if (symbol == nullptr) {
+            symbol = locate_symbol(m_handle, name);
+            if (symbol != nullptr)
+                m_symbol_cache->insert(name, hash, symbol);
+        }
+        return symbol;
+    }
+
+    bool read_export_table(export_table &table) const noexcept {
+#if (defined(_WIN32) || defined(_WIN64))
+        const char *base = reinterpret_cast<const char *>(m_handle);
+        const auto dos_header = reinterpret_cast<const IMAGE_DOS_HEADER *>(base);
+        const auto nt_headers = reinterpret_cast<const IMAGE_NT_HEADERS *>(base + dos_header->e_lfanew);
+        const IMAGE_DATA_DIRECTORY &directory = nt_headers->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+        table.m_base = reinterpret_cast<std::uintptr_t>(base);
+        if (directory.Size == 0)
+            return true;
+        const auto exports = reinterpret_cast<const IMAGE_EXPORT_DIRECTORY *>(base + directory.VirtualAddress);
+        table.m_symbols = base + exports->AddressOfNames;
+        table.m_ordinals = reinterpret_cast<const WORD *>(base + exports->AddressOfNameOrdinals);
+        table.m_functions = reinterpret_cast<const DWORD *>(base + exports->AddressOfFunctions);
+        table.m_directory_begin = directory.VirtualAddress;
+        table.m_directory_end = directory.VirtualAddress + directory.Size;
+        table.m_count = exports->NumberOfNames;
+        return true;
+#elif defined(__APPLE__)
+        uint32_t image = 0;
+        if (!find_image(m_handle, image))
+            return false;
+
+        const auto header = reinterpret_cast<const macho::header_64 *>(_dyld_get_image_header(image));
+        const std::uintptr_t slide = static_cast<std::uintptr_t>(_dyld_get_image_vmaddr_slide(image));
+        const char *linkedit = nullptr;
+        const macho::symtab_command *symtab = nullptr;
+        const macho::dysymtab_command *dysymtab = nullptr;
+
+        auto command = reinterpret_cast<const macho::load_command *>(header + 1);
+        for (uint32_t i = 0; i < header->ncmds; i++) {
+            if (command->cmd == macho::lc_segment_64) {
+                auto segment = reinterpret_cast<const macho::segment_command_64 *>(command);
+                if (std::strcmp(segment->segname, "__LINKEDIT") == 0)
+                    linkedit = reinterpret_cast<const char *>(slide + segment->vmaddr - segment->fileoff);
+            } else if (command->cmd == macho::lc_symtab) {
+                symtab = reinterpret_cast<const macho::symtab_command *>(command);
+            } else if (command->cmd == macho::lc_dysymtab) {
+                dysymtab = reinterpret_cast<const macho::dysymtab_command *>(command);
+            }
+            command = reinterpret_cast<const macho::load_command *>(reinterpret_cast<const char *>(command) + command->cmdsize);
+        }
+        if (linkedit == nullptr || symtab == nullptr)
+            return false;
+
+        auto symbols = reinterpret_cast<const macho::nlist_64 *>(linkedit + symtab->symoff);
+        table.m_base = slide;
+        table.m_strings = linkedit + symtab->stroff;
+        table.m_symbols = dysymtab ? symbols + dysymtab->iextdefsym : symbols;
+        table.m_count = dysymtab ? dysymtab->nextdefsym : symtab->nsyms;
+        return true;
+#else
+        struct link_map *map = nullptr;
+        if (dlinfo(m_handle, RTLD_DI_LINKMAP, &map) != 0 || map == nullptr)
+            return false;
+
+        // depending on the loader, the dynamic section holds either relocated addresses or offsets
+        const std::uintptr_t base = map->l_addr;
+        auto address = [base](ElfW(Addr) pointer) {
+            return reinterpret_cast<const char *>(pointer < base ? base + pointer : pointer);
+        };
+
+        const std::uint32_t *hash = nullptr;
+        const std::uint32_t *gnu_hash = nullptr;
+        for (const ElfW(Dyn) *entry = map->l_ld; entry->d_tag != DT_NULL; entry++) {
+            switch (entry->d_tag) {
+            case DT_SYMTAB:
+                table.m_symbols = address(entry->d_un.d_ptr);
+                break;
+            case DT_STRTAB:
+                table.m_strings = address(entry->d_un.d_ptr);
+                break;
+            case DT_HASH:
+                hash = reinterpret_cast<const std::uint32_t *>(address(entry->d_un.d_ptr));
+                break;
+            case DT_GNU_HASH:
+                gnu_hash = reinterpret_cast<const std::uint32_t *>(address(entry->d_un.d_ptr));
+                break;
+            case DT_VERSYM:
+                table.m_versions = reinterpret_cast<const ElfW(Half) *>(address(entry->d_un.d_ptr));
+                break;
+            default:
+                break;
+            }
+        }
+        if (table.m_symbols == nullptr || table.m_strings == nullptr)
+            return false;
+        table.m_base = base;
+
+        if (hash) {
+            // the chain array of the SysV hash table has one entry per symbol
+            table.m_count = hash[1];
+        } else if (gnu_hash) {
+            // the GNU hash table does not store the symbol count: it ends with the last chain
+            // of the highest used bucket, whose last entry has its lowest bit set
+            const std::uint32_t bucket_count = gnu_hash[0];
+            const std::uint32_t symbol_offset = gnu_hash[1];
+            const std::uint32_t bloom_size = gnu_hash[2];
+            auto buckets = reinterpret_cast<const std::uint32_t *>(
+                reinterpret_cast<const ElfW(Addr) *>(gnu_hash + 4) + bloom_size);
+            const std::uint32_t *chains = buckets + bucket_count;
+
+            std::uint32_t last = 0;
+            for (std::uint32_t i = 0; i < bucket_count; i++)
+                last = (std::max)(last, buckets[i]);
+            if (last >= symbol_offset)
+                while ((chains[last - symbol_offset] & 1) == 0)
+                    last++;
+            table.m_count = last < symbol_offset ? symbol_offset : last + 1;
+        }
+        return true;
+#endif
+    }
+
+#if defined(__APPLE__)
+    static bool find_image(native_handle_type lib, uint32_t &index) noexcept {
+        for (uint32_t image = 0; image < _dyld_image_count(); image++) {
+            void *handle = dlopen(_dyld_get_image_name(image), RTLD_LAZY | RTLD_NOLOAD);
+            if (handle == nullptr)
+                continue;
+            dlclose(handle);
+            if (handle == lib) {
+                index = image;
+                return true;
+            }
+        }
+        return false;
+    }
+#endif
+
+    struct segment {
+        std::uintptr_t begin;
+        std::size_t size;
+        bool readable;
+        bool executable;
+    };
+
+    static std::vector<segment> loaded_segments(native_handle_type lib) {
+        std::vector<segment> segments;
+#if (defined(_WIN32) || defined(_WIN64))
+        const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(lib);
+        const auto dos_header = reinterpret_cast<const IMAGE_DOS_HEADER *>(base);
+        const auto nt_headers = reinterpret_cast<const IMAGE_NT_HEADERS *>(base + dos_header->e_lfanew);
+        const IMAGE_SECTION_HEADER *section = IMAGE_FIRST_SECTION(nt_headers);
+        for (WORD i = 0; i < nt_headers->FileHeader.NumberOfSections; i++, section++)
+            segments.push_back(segment{base + section->VirtualAddress, section->Misc.VirtualSize,
+                (section->Characteristics & IMAGE_SCN_MEM_READ) != 0, (section->Characteristics & IMAGE_SCN_MEM_EXECUTE) != 0});
+#elif defined(__APPLE__)
+        uint32_t image = 0;
+        if (!find_image(lib, image))
+            return segments;
+
+        const auto header = reinterpret_cast<const macho::header_64 *>(_dyld_get_image_header(image));
+        const std::uintptr_t slide = static_cast<std::uintptr_t>(_dyld_get_image_vmaddr_slide(image));
+        auto command = reinterpret_cast<const macho::load_command *>(header + 1);
+        for (uint32_t i = 0; i < header->ncmds; i++) {
+            if (command->cmd == macho::lc_segment_64) {
+                auto loaded = reinterpret_cast<const macho::segment_command_64 *>(command);
+                if (loaded->initprot != macho::prot_none)
+                    segments.push_back(segment{static_cast<std::uintptr_t>(slide + loaded->vmaddr), loaded->vmsize,
+                        (loaded->initprot & macho::prot_read) != 0, (loaded->initprot & macho::prot_execute) != 0});
+            }
+            command = reinterpret_cast<const macho::load_command *>(reinterpret_cast<const char *>(command) + command->cmdsize);
+        }
+#else
+        struct link_map *map = nullptr;
+        if (dlinfo(lib, RTLD_DI_LINKMAP, &map) != 0 || map == nullptr)
+            return segments;
+
+        struct query {
+            const struct link_map *map;
+            std::vector<segment> *segments;
+        } search{map, &segments};
+
+        dl_iterate_phdr([](struct dl_phdr_info *info, std::size_t, void *data) -> int {
+            auto search = static_cast<query *>(data);
+            if (info->dlpi_addr != search->map->l_addr || std::strcmp(info->dlpi_name, search->map->l_name) != 0)
+                return 0;
+            try {
+                for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+                    const ElfW(Phdr) &header = info->dlpi_phdr[i];
+                    if (header.p_type == PT_LOAD)
+                        search->segments->push_back(segment{info->dlpi_addr + header.p_vaddr, header.p_memsz,
+                            (header.p_flags & PF_R) != 0, (header.p_flags & PF_X) != 0});
+                }
+            } catch (const std::bad_alloc &) {
+                search->segments->clear();
+            }
+            return 1;
+        }, &search);
+#endif
+        return segments;
+    }
+
+    static std::size_t page_size() noexcept {
+#if (defined(_WIN32) || defined(_WIN64))
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    static std::size_t prefault_segments(native_handle_type lib, segments which, bool lock) noexcept {
+        std::vector<segment> loaded;
+        try {
+            loaded = loaded_segments(lib);
+        } catch (const std::bad_alloc &) {
+            return 0;
+        }
+
+        const std::size_t page = page_size();
+        std::size_t total = 0;
+        for (auto &area : loaded) {
+            if (!area.readable || (which == segments::text && !area.executable))
+                continue;
+            const std::uintptr_t begin = area.begin & ~static_cast<std::uintptr_t>(page - 1);
+            const std::uintptr_t end = area.begin + area.size;
+            void *address = reinterpret_cast<void *>(begin);
+#if !(defined(_WIN32) || defined(_WIN64))
+            madvise(address, end - begin, MADV_WILLNEED);
+#endif
+            for (std::uintptr_t it = begin; it < end; it += page)
+                static_cast<void>(*reinterpret_cast<const volatile char *>(it));
+            if (lock)
+                DYLIB_WIN_OTHER(VirtualLock, mlock)(address, end - begin);
+            total += end - begin;
+        }
+        return total;
+    }
 
-    static native_handle_type open(const char *path) noexcept {
+    static std::size_t prepare_pages(native_handle_type lib, load_options options) noexcept {
+        const std::size_t huge_page_bytes = has_option(options, load_options::huge_pages) ? remap_huge_pages(lib) : 0;
+        const bool all = has_option(options, load_options::prefault_all);
+        const bool lock = has_option(options, load_options::lock_pages);
+        if (all || lock || has_option(options, load_options::prefault_text))
+            prefault_segments(lib, all ? segments::all : segments::text, lock);
+        return huge_page_bytes;
+    }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    static std::size_t transparent_huge_page_size() noexcept {
+        char buffer[128] = {};
+        int descriptor = ::open("/sys/kernel/mm/transparent_hugepage/enabled", O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0)
+            return 0;
+        const ssize_t length = ::read(descriptor, buffer, sizeof(buffer) - 1);
+        ::close(descriptor);
+        if (length <= 0 || std::strstr(buffer, "[never]") != nullptr)
+            return 0;
+
+        std::memset(buffer, 0, sizeof(buffer));
+        descriptor = ::open("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0)
+            return 2 * 1024 * 1024;
+        const bool read = ::read(descriptor, buffer, sizeof(buffer) - 1) > 0;
+        ::close(descriptor);
+        const unsigned long size = read ? std::strtoul(buffer, nullptr, 10) : 0;
+        return size != 0 && (size & (size - 1)) == 0 ? size : 2 * 1024 * 1024;
+    }
+#endif
+
+    /**
+     *  Copy every huge page aligned part of the executable segments onto a fresh anonymous mapping
+     *  that is allowed to use transparent huge pages, then move it over the original code with
+     *  mremap, which replaces the file backed pages in a single step and leaves them untouched
+     *  if it fails
+     */
+    static std::size_t remap_huge_pages(native_handle_type lib) noexcept {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        const std::size_t huge_page = transparent_huge_page_size();
+        if (huge_page == 0)
+            return 0;
+
+        std::vector<segment> loaded;
+        try {
+            loaded = loaded_segments(lib);
+        } catch (const std::bad_alloc &) {
+            return 0;
+        }
+
+        const std::uintptr_t mask = ~static_cast<std::uintptr_t>(huge_page - 1);
+        std::size_t total = 0;
+        for (auto &area : loaded) {
+            if (!area.readable || !area.executable)
+                continue;
+            const std::uintptr_t begin = (area.begin + huge_page - 1) & mask;
+            const std::uintptr_t end = (area.begin + area.size) & mask;
+            if (begin >= end)
+                continue;
+            const std::size_t length = end - begin;
+
+            void *reserved = mmap(nullptr, length + huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (reserved == MAP_FAILED)
+                continue;
+            const std::uintptr_t reserved_begin = reinterpret_cast<std::uintptr_t>(reserved);
+            const std::uintptr_t aligned = (reserved_begin + huge_page - 1) & mask;
+            if (aligned != reserved_begin)
+                munmap(reserved, aligned - reserved_begin);
+            if (aligned + length != reserved_begin + length + huge_page)
+                munmap(reinterpret_cast<void *>(aligned + length), reserved_begin + huge_page - aligned);
+
+            char *copy = reinterpret_cast<char *>(aligned);
+            if (madvise(copy, length, MADV_HUGEPAGE) != 0) {
+                munmap(copy, length);
+                continue;
+            }
+            std::memcpy(copy, reinterpret_cast<const void *>(begin), length);
+#if defined(__GNUC__)
+            __builtin___clear_cache(copy, copy + length);
+#endif
+            if (mprotect(copy, length, PROT_READ | PROT_EXEC) != 0 ||
+                mremap(copy, length, length, MREMAP_MAYMOVE | MREMAP_FIXED, reinterpret_cast<void *>(begin)) == MAP_FAILED) {
+                munmap(copy, length);
+                continue;
+            }
+            total += length;
+        }
+        return total;
+#else
+        static_cast<void>(lib);
+        return 0;
+#endif
+    }
+
+    native_symbol_type locate_versioned_symbol(const char *name, const char *version, bool *cache_hit = nullptr) const noexcept {
+        if (!m_symbol_cache)
+            return locate_symbol(m_handle, name, version);
+        try {
+            // versioned symbols are cached under "name@version", a key no unversioned symbol can collide with
+            path_buffer key;
+            key.append(name, std::strlen(name));
+            key.append("@", 1);
+            key.append(version, std::strlen(version));
+
+            const std::uint64_t hash = hash_symbol_name(key.c_str());
+            auto symbol = m_symbol_cache->find(key.c_str(), hash);
+            if (cache_hit)
+                *cache_hit = symbol != nullptr;
+            if (symbol == nullptr) {
+                symbol = locate_symbol(m_handle, name, version);
+                if (symbol != nullptr)
+                    m_symbol_cache->insert(key.c_str(), hash, symbol);
+            }
+            return symbol;
+        } catch (const std::bad_alloc &) {
+            return locate_symbol(m_handle, name, version);
+        }
+    }
+
+    static cpu_features detect_cpu_features() noexcept {
+        cpu_features features = cpu_features::none;
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse4.2"))
+            features = features | cpu_features::sse4_2;
+        if (__builtin_cpu_supports("avx"))
+            features = features | cpu_features::avx;
+        if (__builtin_cpu_supports("avx2"))
+            features = features | cpu_features::avx2;
+        if (__builtin_cpu_supports("fma"))
+            features = features | cpu_features::fma;
+        if (__builtin_cpu_supports("avx512f"))
+            features = features | cpu_features::avx512f;
+        if (__builtin_cpu_supports("avx512bw"))
+            features = features | cpu_features::avx512bw;
+        if (__builtin_cpu_supports("avx512vl"))
+            features = features | cpu_features::avx512vl;
+#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        const int max_leaf = info[0];
+        __cpuid(info, 1);
+        const bool os_saves_avx = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        const bool os_saves_avx512 = os_saves_avx && (_xgetbv(0) & 0xe6) == 0xe6;
+        if (info[2] & (1 << 20))
+            features = features | cpu_features::sse4_2;
+        if (os_saves_avx && (info[2] & (1 << 28)))
+            features = features | cpu_features::avx;
+        if (os_saves_avx && (info[2] & (1 << 12)))
+            features = features | cpu_features::fma;
+        if (max_leaf >= 7) {
+            __cpuidex(info, 7, 0);
+            if (os_saves_avx && (info[1] & (1 << 5)))
+                features = features | cpu_features::avx2;
+            if (os_saves_avx512 && (info[1] & (1 << 16)))
+                features = features | cpu_features::avx512f;
+            if (os_saves_avx512 && (info[1] & (1 << 30)))
+                features = features | cpu_features::avx512bw;
+            if (os_saves_avx512 && (info[1] & (1u << 31)))
+                features = features | cpu_features::avx512vl;
+        }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+        features = features | cpu_features::neon;
+#if defined(__linux__) && defined(HWCAP_SVE)
+        if (getauxval(AT_HWCAP) & HWCAP_SVE)
+            features = features | cpu_features::sve;
+#endif
+#endif
+        return features;
+    }
+
+    static constexpr bool has_option(load_options options, load_options option) noexcept {
+        return (options & option) == option;
+    }
+
+    static native_handle_type open(const char *path, load_options options = load_options::defaults) noexcept {
 #if (defined(_WIN32) || defined(_WIN64))
-        return LoadLibraryA(path);
+        DWORD flags = 0;
+        if (has_option(options, load_options::search_dll_load_dir))
+            flags |= LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR;
+        if (has_option(options, load_options::search_application_dir))
+            flags |= LOAD_LIBRARY_SEARCH_APPLICATION_DIR;
+        if (has_option(options, load_options::search_user_dirs))
+            flags |= LOAD_LIBRARY_SEARCH_USER_DIRS;
+        if (has_option(options, load_options::search_system32))
+            flags |= LOAD_LIBRARY_SEARCH_SYSTEM32;
+        if (has_option(options, load_options::search_default_dirs))
+            flags |= LOAD_LIBRARY_SEARCH_DEFAULT_DIRS;
+        if (has_option(options, load_options::dont_resolve_dll_references))
+            flags |= DONT_RESOLVE_DLL_REFERENCES;
+
+        auto handle = LoadLibraryExA(path, nullptr, flags);
+        if (handle && has_option(options, load_options::nodelete)) {
+            HMODULE pinned = nullptr;
+            GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+                               reinterpret_cast<LPCSTR>(handle), &pinned);
+        }
+        return handle;
 #else
-        return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+        int flags = has_option(options, load_options::lazy) ? RTLD_LAZY : RTLD_NOW;
+        flags |= has_option(options, load_options::global) ? RTLD_GLOBAL : RTLD_LOCAL;
+#ifdef RTLD_NODELETE
+        if (has_option(options, load_options::nodelete))
+            flags |= RTLD_NODELETE;
+#endif
+#ifdef RTLD_DEEPBIND
+        if (has_option(options, load_options::deepbind))
+            flags |= RTLD_DEEPBIND;
+#endif
+#ifdef DYLIB_DLMOPEN
+        if (has_option(options, load_options::isolated))
+            return dlmopen(LM_ID_NEWLM, path, flags & ~RTLD_GLOBAL);
+#endif
+        return dlopen(path, flags);
 #endif
     }
 
     static native_symbol_type locate_symbol(native_handle_type lib, const char *name) noexcept {
-        return DYLIB_WIN_OTHER(GetProcAddress, dlsym)(lib, name);
+        auto symbol = DYLIB_WIN_OTHER(GetProcAddress, dlsym)(lib, name);
+        if (symbol == nullptr)
+            capture_lookup_error();
+        return symbol;
+    }
+
+    static native_symbol_type locate_symbol(native_handle_type lib, const char *name, const char *version) noexcept {
+#if defined(__GLIBC__)
+        auto symbol = dlvsym(lib, name, version);
+        if (symbol == nullptr)
+            capture_lookup_error();
+        return symbol;
+#else
+        static_cast<void>(lib);
+        static_cast<void>(name);
+        static_cast<void>(version);
+        return nullptr;
+#endif
+    }
+
+    static std::string versioned_error_description() noexcept {
+#if defined(__GLIBC__)
+        return lookup_error_description();
+#else
+        return "Symbol versioning is not supported on this platform";
+#endif
     }
 
     static void close(native_handle_type lib) noexcept {
         DYLIB_WIN_OTHER(FreeLibrary, dlclose)(lib);
     }
 
+    static void close_observed(native_handle_type lib) noexcept {
+#ifdef DYLIB_INSTRUMENTATION
+        const auto start = std::chrono::steady_clock::now();
+        close(lib);
+        auto watcher = observer_slot().load(std::memory_order_acquire);
+        if (watcher) {
+            try {
+                watcher->on_close(lib, std::chrono::steady_clock::now() - start);
+            } catch (...) {}
+        }
+#else
+        close(lib);
+#endif
+    }
+
+    /**
+     *  The description of the last failed lookup of the calling thread, captured right after the
+     *  failure so that no other call to the dynamic loader can replace it before it is reported
+     */
+    static constexpr std::size_t lookup_error_capacity = 512;
+
+    static char *lookup_error() noexcept {
+        static thread_local char description[lookup_error_capacity] = {};
+        return description;
+    }
+
+    static void capture_lookup_error() noexcept {
+        char *description = lookup_error();
+#if (defined(_WIN32) || defined(_WIN64))
+        auto error_code = GetLastError();
+        auto lang = MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US);
+        if (!error_code)
+            std::snprintf(description, lookup_error_capacity, "%s", "Unknown error (GetLastError failed)");
+        else if (!FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, nullptr, error_code, lang, description,
+                static_cast<DWORD>(lookup_error_capacity), nullptr))
+            std::snprintf(description, lookup_error_capacity, "%s", "Unknown error (FormatMessage failed)");
+#else
+        const char *error = dlerror();
+        std::snprintf(description, lookup_error_capacity, "%s", error ? error : "Unknown error (dlerror failed)");
+#endif
+    }
+
+    static std::string lookup_error_description() noexcept {
+        return lookup_error();
+    }
+
     static std::string get_error_description() noexcept {
 #if (defined(_WIN32) || defined(_WIN64))
         constexpr const size_t buf_size = 512;
@@ -304,6 +5606,12 @@ protected:
     }
 };
 
+/**
+ *  A dynamic library shared by several holders, see dylib::registry
+ */
+using shared_dylib = std::shared_ptr<const dylib>;
+
 #undef DYLIB_WIN_MAC_OTHER
 #undef DYLIB_WIN_OTHER
 #undef DYLIB_CPP17
+#undef DYLIB_DLMOPEN
@@ -0,0 +1,13 @@
+#if defined(_WIN32) || defined(_WIN64)
+#define LIB_EXPORT __declspec(dllexport)
+#else
+#define LIB_EXPORT
+#endif
+
+extern "C" {
+
+LIB_EXPORT int dependency_value() {
+    return 42;
+}
+
+} // extern "C"
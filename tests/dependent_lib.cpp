@@ -0,0 +1,17 @@
+#if defined(_WIN32) || defined(_WIN64)
+#define LIB_EXPORT __declspec(dllexport)
+#define LIB_IMPORT __declspec(dllimport)
+#else
+#define LIB_EXPORT
+#define LIB_IMPORT
+#endif
+
+extern "C" {
+
+LIB_IMPORT int dependency_value();
+
+LIB_EXPORT int dependent_value() {
+    return dependency_value() + 1;
+}
+
+} // extern "C"
@@ -10,6 +10,7 @@ extern "C" {
 
 LIB_EXPORT double pi_value = 3.14159;
 LIB_EXPORT void *ptr = (void *)1;
+LIB_EXPORT int counter = 0;
 
 LIB_EXPORT double adder(double a, double b) {
     return a + b;
@@ -19,4 +20,19 @@ LIB_EXPORT void print_hello() {
     std::cout << "Hello" << std::endl;
 }
 
-} // extern "C"
\ No newline at end of file
+#ifdef DYLIB_TEST_SYMBOL_VERSIONS
+LIB_EXPORT int versioned_v1() {
+    return 1;
+}
+
+LIB_EXPORT int versioned_v2() {
+    return 2;
+}
+#endif
+
+} // extern "C"
+
+#ifdef DYLIB_TEST_SYMBOL_VERSIONS
+__asm__(".symver versioned_v1, versioned@LIB_1.0");
+__asm__(".symver versioned_v2, versioned@@LIB_2.0");
+#endif
\ No newline at end of file
@@ -0,0 +1,271 @@
+/*
+ *  Stress tests on many generated libraries, built with DYLIB_BUILD_STRESS_TESTS.
+ *  Each of the DYLIB_STRESS_LIBRARIES libraries exports 10^DYLIB_STRESS_SYMBOL_DIGITS functions,
+ *  see benchmarks/generated_lib.cpp
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "dylib.hpp"
+
+#if (defined(_WIN32) || defined(_WIN64))
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#ifndef DYLIB_STRESS_LIBRARIES
+#define DYLIB_STRESS_LIBRARIES 200
+#endif
+
+#ifndef DYLIB_STRESS_SYMBOL_DIGITS
+#define DYLIB_STRESS_SYMBOL_DIGITS 4
+#endif
+
+// throughput floors far below what any machine reaches, even a loaded CI runner or a sanitizer build,
+// catching order of magnitude regressions
+static const double min_loads_per_second = 100;
+static const double min_lookups_per_second = 5000;
+
+// growth of the resident memory tolerated between load and unload cycles
+static const std::size_t leak_budget = 8 * 1024 * 1024;
+
+static const std::size_t library_count = DYLIB_STRESS_LIBRARIES;
+
+static std::size_t symbol_count() {
+    std::size_t count = 1;
+    for (int i = 0; i < DYLIB_STRESS_SYMBOL_DIGITS; i++)
+        count *= 10;
+    return count;
+}
+
+static std::string library_name(std::size_t index) {
+    return "stress_lib_" + std::to_string(index);
+}
+
+static std::vector<std::string> library_paths() {
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < library_count; i++)
+        paths.push_back(std::string("./") + dylib::filename_components::prefix + library_name(i) +
+                        dylib::filename_components::suffix);
+    return paths;
+}
+
+static std::vector<std::string> symbol_names() {
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < symbol_count(); i++) {
+        const std::string index = std::to_string(i);
+        names.push_back("symbol_" + std::string(DYLIB_STRESS_SYMBOL_DIGITS - index.size(), '0') + index);
+    }
+    return names;
+}
+
+static unsigned thread_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *name, double value) {
+    std::printf("[ measure  ] %s: %.0f\n", name, value);
+    testing::Test::RecordProperty(name, std::to_string(static_cast<std::int64_t>(value)));
+}
+
+static std::size_t resident_bytes() {
+#if (defined(_WIN32) || defined(_WIN64))
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+    return info.resident_size;
+#else
+    std::FILE *statm = std::fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const bool read = std::fscanf(statm, "%lu %lu", &size, &resident) == 2;
+    std::fclose(statm);
+    return read ? resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#endif
+}
+
+// the memory freed by the process can stay in the allocator, give it back before measuring
+static void release_free_memory() {
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+TEST(many_libraries, load_unload_throughput) {
+    const std::string last_symbol = symbol_names().back();
+    const bool decorations = dylib::add_filename_decorations;
+
+    for (auto options : {dylib::load_options::defaults, dylib::load_options::deferred_close}) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < 3; round++) {
+            std::vector<dylib> libs;
+            for (std::size_t i = 0; i < library_count; i++) {
+                libs.emplace_back("./", library_name(i), decorations, options);
+                ASSERT_TRUE(libs.back().has_symbol(last_symbol));
+            }
+        }
+        dylib::flush_closes();
+        EXPECT_EQ(dylib::pending_closes(), 0u);
+
+        const double rate = 3 * library_count / seconds_since(start);
+        report(options == dylib::load_options::defaults ? "loads_per_second" : "deferred_loads_per_second", rate);
+        EXPECT_GT(rate, min_loads_per_second);
+    }
+}
+
+TEST(many_libraries, load_all_throughput) {
+    const auto paths = library_paths();
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < 3; round++) {
+        auto batch = dylib::load_all(paths, thread_count());
+        ASSERT_TRUE(batch.ok());
+        ASSERT_EQ(batch.libraries.size(), library_count);
+
+        std::unordered_set<dylib::native_handle_type> handles;
+        for (auto &lib : batch.libraries)
+            handles.insert(lib.native_handle());
+        EXPECT_EQ(handles.size(), library_count);
+    }
+
+    const double rate = 3 * library_count / seconds_since(start);
+    report("batch_loads_per_second", rate);
+    EXPECT_GT(rate, min_loads_per_second);
+}
+
+TEST(many_threads, get_symbol) {
+    const auto names = symbol_names();
+    auto batch = dylib::load_all(library_paths(), thread_count());
+    ASSERT_TRUE(batch.ok());
+    auto &libs = batch.libraries;
+
+    // every library is linked from the same objects, the functions are at the same offsets in each of them
+    std::vector<std::ptrdiff_t> offsets;
+    const auto first = reinterpret_cast<const char *>(libs[0].get_symbol(names[0].c_str()));
+    for (const auto &name : names)
+        offsets.push_back(reinterpret_cast<const char *>(libs[0].get_symbol(name.c_str())) - first);
+    std::vector<const char *> bases;
+    for (std::size_t i = 0; i < libs.size(); i++) {
+        bases.push_back(reinterpret_cast<const char *>(libs[i].get_symbol(names[0].c_str())));
+        if (i % 2 == 0)
+            libs[i].enable_symbol_cache();
+    }
+
+    const std::size_t lookups_per_thread = 200000;
+    std::atomic<std::size_t> mismatches{0};
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < thread_count(); t++) {
+        threads.emplace_back([&, t]() {
+            std::uint64_t state = 0x9e3779b97f4a7c15ull * (t + 1);
+            std::size_t wrong = 0;
+            for (std::size_t i = 0; i < lookups_per_thread; i++) {
+                state = state * 6364136223846793005ull + 1442695040888963407ull;
+                const std::size_t lib = static_cast<std::size_t>(state >> 33) % libs.size();
+                const std::size_t symbol = static_cast<std::size_t>(state >> 13) % names.size();
+                auto address = reinterpret_cast<const char *>(libs[lib].get_symbol(names[symbol].c_str()));
+                if (address != bases[lib] + offsets[symbol])
+                    wrong++;
+                const int value = static_cast<int>(i);
+                if (i % 1024 == 0 && libs[lib].get_function<int(int)>(names[symbol])(value) != value + 1)
+                    wrong++;
+            }
+            mismatches += wrong;
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    const double rate = thread_count() * lookups_per_thread / seconds_since(start);
+    report("lookups_per_second", rate);
+    EXPECT_EQ(mismatches.load(), 0u);
+    EXPECT_GT(rate, min_lookups_per_second);
+}
+
+TEST(many_threads, registry_dedup) {
+    dylib::registry registry;
+    std::vector<std::vector<shared_dylib>> opened(thread_count());
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < thread_count(); t++) {
+        threads.emplace_back([&registry, &opened, t]() {
+            // each thread opens the libraries in a different order
+            for (std::size_t i = 0; i < library_count; i++)
+                opened[t].push_back(registry.open("./", library_name((i * (2 * t + 1) + t) % library_count)));
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(registry.size(), library_count);
+    std::vector<shared_dylib> by_library(library_count);
+    for (unsigned t = 0; t < thread_count(); t++) {
+        for (std::size_t i = 0; i < library_count; i++) {
+            auto &expected = by_library[(i * (2 * t + 1) + t) % library_count];
+            if (!expected)
+                expected = opened[t][i];
+            EXPECT_EQ(opened[t][i], expected);
+        }
+    }
+    std::unordered_set<const dylib *> distinct;
+    for (auto &lib : by_library)
+        distinct.insert(lib.get());
+    EXPECT_EQ(distinct.size(), library_count);
+
+    opened.clear();
+    by_library.clear();
+    EXPECT_EQ(registry.size(), 0u);
+}
+
+TEST(many_libraries, resident_memory) {
+    const auto paths = library_paths();
+    release_free_memory();
+    const std::size_t baseline = resident_bytes();
+    if (baseline == 0)
+        GTEST_SKIP() << "the resident memory size is not available";
+
+    std::vector<std::size_t> loaded;
+    std::vector<std::size_t> unloaded;
+    for (int cycle = 0; cycle < 3; cycle++) {
+        {
+            auto batch = dylib::load_all(paths, thread_count(), {}, dylib::load_options::prefault_all);
+            ASSERT_TRUE(batch.ok());
+            for (auto &lib : batch.libraries)
+                lib.preload_exported_symbols();
+            loaded.push_back(resident_bytes());
+        }
+        release_free_memory();
+        unloaded.push_back(resident_bytes());
+    }
+
+    report("resident_bytes_baseline", static_cast<double>(baseline));
+    report("resident_bytes_loaded", static_cast<double>(loaded.back()));
+    report("resident_bytes_unloaded", static_cast<double>(unloaded.back()));
+    for (int cycle = 0; cycle < 3; cycle++) {
+        EXPECT_GT(loaded[cycle], baseline);
+        EXPECT_LT(unloaded[cycle], loaded[cycle]);
+    }
+    EXPECT_LT(unloaded.back(), unloaded.front() + leak_budget);
+}
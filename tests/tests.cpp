@@ -1,7 +1,42 @@
 #include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <thread>
 #include <utility>
+#include <vector>
 #include "dylib.hpp"
 
+// counts the allocations of the calling thread, to check the paths documented as not allocating
+static thread_local std::size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+    allocations++;
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#endif
+
 TEST(example, example_test) {
     testing::internal::CaptureStdout();
     dylib lib("./", "dynamic_lib");
@@ -30,11 +65,217 @@ TEST(ctor, bad_library) {
     }
 }
 
+static std::string dynamic_lib_path() {
+    return std::string("./") + dylib::filename_components::prefix + "dynamic_lib" + dylib::filename_components::suffix;
+}
+
+static void copy_library(const std::string &from, const std::string &to) {
+    const std::string temporary = to + ".tmp";
+    {
+        std::ifstream input(from, std::ios::binary);
+        std::ofstream output(temporary, std::ios::binary);
+        output << input.rdbuf();
+    }
+    std::remove(to.c_str());
+    ASSERT_EQ(std::rename(temporary.c_str(), to.c_str()), 0);
+}
+
+TEST(ctor, load_options) {
+    dylib lazy("./", "dynamic_lib", dylib::add_filename_decorations, dylib::load_options::lazy);
+    EXPECT_EQ(lazy.get_function<double(double, double)>("adder")(1, 2), 3);
+
+    // nodelete pins the library until exit, a copy keeps its globals out of the other tests
+    const std::string name = "nodelete_lib";
+    copy_library(dynamic_lib_path(), "./" + (dylib::filename_components::prefix + name) + dylib::filename_components::suffix);
+    auto options = dylib::load_options::lazy | dylib::load_options::global | dylib::load_options::nodelete;
+    dylib lib("./", name, dylib::add_filename_decorations, options);
+    EXPECT_TRUE(lib.has_symbol("pi_value"));
+
+    dylib deepbind(std::string("./"), "dynamic_lib", dylib::add_filename_decorations, dylib::load_options::deepbind);
+    EXPECT_TRUE(deepbind.has_symbol("adder"));
+
+    EXPECT_THROW(dylib("./", "no_such_library", dylib::add_filename_decorations, dylib::load_options::lazy),
+                 dylib::load_error);
+}
+
 TEST(multiple_handles, basic_test) {
     dylib libA("./", "dynamic_lib");
     dylib libB("./", "dynamic_lib");
 }
 
+TEST(registry, basic_test) {
+    dylib::registry registry;
+    EXPECT_EQ(registry.size(), 0u);
+
+    shared_dylib libA = registry.open("./", "dynamic_lib");
+    shared_dylib libB = registry.open(".", std::string("dynamic_lib"));
+    EXPECT_EQ(libA, libB);
+    EXPECT_EQ(registry.size(), 1u);
+    static_assert(std::is_const<shared_dylib::element_type>::value, "The holders must not disable the shared cache");
+    EXPECT_TRUE(libA->symbol_cache_enabled());
+    EXPECT_EQ(libB->get_function<double(double, double)>("adder")(1, 2), 3);
+
+    libA.reset();
+    EXPECT_EQ(registry.size(), 1u);
+    libB.reset();
+    EXPECT_EQ(registry.size(), 0u);
+
+    EXPECT_THROW(registry.open("./", "no_such_library"), dylib::load_error);
+    EXPECT_EQ(registry.size(), 0u);
+    EXPECT_THROW(registry.open(nullptr), std::invalid_argument);
+}
+
+TEST(registry, concurrent_open) {
+    std::vector<std::thread> threads;
+    std::vector<shared_dylib> libs(8);
+    for (std::size_t i = 0; i < libs.size(); i++)
+        threads.emplace_back([&libs, i]() {
+            libs[i] = dylib::registry::instance().open("./", "dynamic_lib");
+            libs[i]->get_variable<double>("pi_value");
+        });
+    for (auto &thread : threads)
+        thread.join();
+
+    for (auto &lib : libs)
+        EXPECT_EQ(lib, libs.front());
+    EXPECT_EQ(dylib::registry::instance().size(), 1u);
+    libs.clear();
+    EXPECT_EQ(dylib::registry::instance().size(), 0u);
+}
+
+TEST(load_all, basic_test) {
+    std::vector<std::string> paths(6, dynamic_lib_path());
+    paths[2] = "./no_such_library";
+
+    auto result = dylib::load_all(paths, 4);
+    EXPECT_FALSE(result.ok());
+    ASSERT_EQ(result.libraries.size(), paths.size());
+    ASSERT_EQ(result.errors.size(), 1u);
+    EXPECT_EQ(result.errors[0].index, 2u);
+    EXPECT_EQ(result.errors[0].path, paths[2]);
+    EXPECT_EQ(result.libraries[2].native_handle(), nullptr);
+
+    for (std::size_t i = 0; i < paths.size(); i++)
+        EXPECT_EQ(result.libraries[i].has_symbol("pi_value"), i != 2);
+
+    EXPECT_TRUE(dylib::load_all({}).ok());
+}
+
+TEST(load_all, load_order) {
+    std::vector<std::string> paths = {dynamic_lib_path(), "./no_such_library", dynamic_lib_path(), dynamic_lib_path()};
+
+    auto result = dylib::load_all(paths, 2, {{0, 2}, {1, 2}, {2, 3}});
+    ASSERT_EQ(result.errors.size(), 3u);
+    EXPECT_TRUE(result.libraries[0].has_symbol("adder"));
+    EXPECT_FALSE(result.libraries[2].has_symbol("adder"));
+    EXPECT_FALSE(result.libraries[3].has_symbol("adder"));
+
+    auto circular = dylib::load_all({dynamic_lib_path(), dynamic_lib_path(), dynamic_lib_path()}, 2, {{0, 1}, {1, 0}});
+    ASSERT_EQ(circular.errors.size(), 2u);
+    EXPECT_TRUE(circular.libraries[2].has_symbol("adder"));
+
+    EXPECT_THROW(dylib::load_all(paths, 1, {{0, 4}}), std::invalid_argument);
+}
+
+TEST(dependency_graph, basic_test) {
+    const std::string dependent = std::string("./") + dylib::filename_components::prefix + "dependent_lib" +
+        dylib::filename_components::suffix;
+    dylib::dependency_graph graph({dependent});
+    const auto &libraries = graph.libraries();
+    ASSERT_GE(libraries.size(), 2u);
+    EXPECT_TRUE(libraries[0].root);
+    EXPECT_FALSE(libraries[0].loaded);
+    EXPECT_EQ(libraries[0].path, dependent);
+
+    std::size_t dependency = libraries.size();
+    for (auto index : libraries[0].dependencies)
+        if (libraries[index].name.find("dependency_lib") != std::string::npos)
+            dependency = index;
+    ASSERT_NE(dependency, libraries.size());
+    EXPECT_FALSE(libraries[dependency].root);
+    EXPECT_FALSE(libraries[dependency].loaded);
+    EXPECT_FALSE(libraries[dependency].path.empty());
+    EXPECT_EQ(libraries[dependency].required_by, 1u);
+
+    const auto order = graph.load_order();
+    ASSERT_EQ(order.size(), libraries.size());
+    const auto position = [&order](std::size_t index) {
+        return std::find(order.begin(), order.end(), index) - order.begin();
+    };
+    for (std::size_t i = 0; i < libraries.size(); i++)
+        for (auto needed : libraries[i].dependencies)
+            EXPECT_LT(position(needed), position(i));
+
+    const auto report = graph.preload(2);
+    EXPECT_TRUE(report.errors.empty());
+    EXPECT_GE(report.preloaded, 1u);
+    EXPECT_TRUE(graph.libraries()[dependency].loaded);
+    EXPECT_GE(report.elapsed.count(), 0);
+    EXPECT_LE(report.advise_time, report.elapsed);
+    EXPECT_TRUE(dylib::dependency_graph({dependent}).libraries()[dependency].loaded);
+
+    dylib lib(dependent, dylib::no_filename_decorations);
+    EXPECT_EQ(lib.get_function<int()>("dependent_value")(), 43);
+
+    EXPECT_THROW(dylib::dependency_graph({"./no_such_library"}), dylib::load_error);
+}
+
+TEST(preload_symbols, basic_test) {
+    dylib lib("./", "dynamic_lib");
+    lib.preload_symbols({"adder", "pi_value"});
+    EXPECT_TRUE(lib.symbol_cache_enabled());
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(1, 1), 2);
+
+    try {
+        lib.preload_symbols({"unknown_first", "adder", "unknown_second"});
+        EXPECT_EQ(true, false);
+    }
+    catch (const dylib::symbol_error &e) {
+        EXPECT_NE(std::string(e.what()).find("\"unknown_first\", \"unknown_second\""), std::string::npos);
+    }
+}
+
+TEST(load_async, future) {
+    auto pending = dylib::load_async("./", "dynamic_lib", {"adder", "print_hello"});
+    dylib lib = pending.get();
+    EXPECT_TRUE(lib.symbol_cache_enabled());
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(5, 10), 15);
+
+    EXPECT_THROW(dylib::load_async("./", "no_such_library").get(), dylib::load_error);
+    EXPECT_THROW(dylib::load_async("./", "dynamic_lib", {"unknown"}).get(), dylib::symbol_error);
+}
+
+TEST(load_async, callback) {
+    std::promise<double> loaded;
+    dylib::load_async([&loaded](dylib lib, std::exception_ptr error) {
+        if (error)
+            loaded.set_exception(error);
+        else
+            loaded.set_value(lib.get_variable<double>("pi_value"));
+    }, "./", "dynamic_lib", {"pi_value"});
+    EXPECT_EQ(loaded.get_future().get(), 3.14159);
+
+    std::promise<bool> failed;
+    dylib::load_async([&failed](dylib lib, std::exception_ptr error) {
+        failed.set_value(error != nullptr && lib.native_handle() == nullptr);
+    }, "./", "no_such_library");
+    EXPECT_TRUE(failed.get_future().get());
+
+    // the loads run in call order, and a throwing callback does not stop the next ones
+    std::vector<int> order;
+    std::promise<void> done;
+    dylib::load_async([&order](dylib, std::exception_ptr) {
+        order.push_back(1);
+        throw std::runtime_error("ignored");
+    }, "./", "dynamic_lib");
+    dylib::load_async([&order, &done](dylib, std::exception_ptr) {
+        order.push_back(2);
+        done.set_value();
+    }, "./", "dynamic_lib");
+    done.get_future().get();
+    EXPECT_EQ(order, std::vector<int>({1, 2}));
+}
+
 TEST(get_function, bad_symbol) {
     try {
         dylib lib("./", "dynamic_lib");
@@ -46,6 +287,54 @@ TEST(get_function, bad_symbol) {
     }
 }
 
+TEST(profiled_function, basic_test) {
+    dylib lib("./", "dynamic_lib");
+    auto adder = lib.get_profiled_function<double(double, double)>("adder");
+    auto hello = lib.get_profiled_function<void()>(DYLIB_SYMBOL("print_hello"));
+    EXPECT_EQ(adder.get(), lib.get_function<double(double, double)>("adder"));
+    EXPECT_EQ(&adder.profiler(), &lib.get_profiled_function<double(double, double)>(std::string("adder")).profiler());
+    EXPECT_NE(&adder.profiler(), &hello.profiler());
+    EXPECT_EQ(adder.profiler().symbol(), "adder");
+    EXPECT_THROW(lib.get_profiled_function<void()>("unknown"), dylib::symbol_error);
+
+    EXPECT_FALSE(dylib::profiling_enabled());
+    EXPECT_EQ(adder(5, 10), 15);
+    EXPECT_EQ(adder.profiler().snapshot().calls, 0u);
+
+    dylib::set_profiling(true);
+    for (int i = 0; i < 10; i++)
+        EXPECT_EQ(adder(i, 1), i + 1);
+    std::thread worker([&adder] {
+        for (int i = 0; i < 20; i++)
+            adder(i, 2);
+    });
+    worker.join();
+    testing::internal::CaptureStdout();
+    hello();
+    testing::internal::GetCapturedStdout();
+    dylib::set_profiling(false);
+    adder(1, 1);
+
+    const dylib::call_profile profile = adder.profiler().snapshot();
+    EXPECT_EQ(profile.symbol, "adder");
+    EXPECT_EQ(profile.calls, 30u);
+    EXPECT_GE(profile.max_time, profile.mean_time());
+    EXPECT_LE(profile.max_time, profile.total_time);
+    ASSERT_FALSE(profile.histogram.empty());
+    std::uint64_t calls = 0;
+    for (const auto &bucket : profile.histogram)
+        calls += bucket.calls;
+    EXPECT_EQ(calls, 30u);
+    EXPECT_NE(profile.histogram.back().calls, 0u);
+    EXPECT_LE(profile.percentile(0.5), profile.percentile(1.0));
+    EXPECT_EQ(hello.profiler().snapshot().calls, 1u);
+
+    bool listed = false;
+    for (const auto &entry : dylib::call_profiles())
+        listed = listed || (entry.symbol == "adder" && entry.calls == 30u);
+    EXPECT_TRUE(listed);
+}
+
 TEST(get_variable, bad_symbol) {
     try {
         dylib lib("./", "dynamic_lib");
@@ -57,6 +346,212 @@ TEST(get_variable, bad_symbol) {
     }
 }
 
+TEST(load_variant, basic_test) {
+    EXPECT_EQ(dylib::detected_cpu_features(), dylib::detected_cpu_features());
+
+    // no processor supports both the x86 and the ARM extensions
+    auto lib = dylib::load_variant("./", "dynamic_lib", {
+        {"_impossible", dylib::cpu_features::sse4_2 | dylib::cpu_features::neon},
+        {"_missing", dylib::cpu_features::none},
+        {"", dylib::cpu_features::none},
+    });
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(5, 10), 15);
+
+    try {
+        dylib::load_variant("./", "dynamic_lib", {{"_missing", dylib::cpu_features::none}});
+        FAIL() << "expected a load_error";
+    } catch (const dylib::load_error &error) {
+        EXPECT_NE(std::string(error.what()).find("dynamic_lib_missing"), std::string::npos);
+    }
+    EXPECT_THROW(dylib::load_variant("./", "dynamic_lib", {}), std::invalid_argument);
+}
+
+TEST(try_get_symbol, basic_test) {
+    dylib lib("./", "dynamic_lib");
+
+    auto adder = lib.try_get_function<double(double, double)>("adder");
+    ASSERT_TRUE(adder);
+    EXPECT_EQ(adder.error(), dylib::symbol_errc::none);
+    EXPECT_EQ(adder.get()(1, 2), 3);
+    EXPECT_EQ(adder.value(), lib.get_function<double(double, double)>("adder"));
+    EXPECT_TRUE(adder.message().empty());
+
+    auto pi = lib.try_get_variable<double>(std::string("pi_value"));
+    ASSERT_TRUE(pi);
+    EXPECT_EQ(*pi.get(), 3.14159);
+
+    auto symbol = lib.try_get_symbol("ptr");
+    EXPECT_EQ(symbol.get(), lib.get_symbol("ptr"));
+}
+
+TEST(try_get_symbol, bad_symbol) {
+    dylib lib("./", "dynamic_lib");
+
+    auto unknown = lib.try_get_function<void()>("unknown");
+    EXPECT_FALSE(unknown);
+    EXPECT_EQ(unknown.get(), nullptr);
+    EXPECT_EQ(unknown.error(), dylib::symbol_errc::not_found);
+    EXPECT_NE(unknown.message().find("\"unknown\""), std::string::npos);
+    EXPECT_THROW(unknown.value(), dylib::symbol_error);
+
+    auto null_name = lib.try_get_variable<double>(nullptr);
+    EXPECT_EQ(null_name.error(), dylib::symbol_errc::null_name);
+    EXPECT_THROW(null_name.value(), std::invalid_argument);
+
+    dylib other(std::move(lib));
+    auto null_handle = lib.try_get_symbol("adder");
+    EXPECT_EQ(null_handle.error(), dylib::symbol_errc::null_handle);
+    EXPECT_THROW(null_handle.value(), std::logic_error);
+
+    // the result outlives both the name it was given and the library
+    auto detached = dylib("./", "dynamic_lib").try_get_variable<int>(std::string("no_such_variable"));
+    EXPECT_NE(detached.message().find("\"no_such_variable\""), std::string::npos);
+    EXPECT_THROW(detached.value(), dylib::symbol_error);
+}
+
+TEST(try_get_symbol, no_allocation) {
+    dylib lib("./", "dynamic_lib");
+    lib.try_get_symbol("unknown");
+
+    const std::size_t before = allocations;
+    auto unknown = lib.try_get_function<void()>("unknown");
+    auto missing = lib.try_get_variable<int>("missing");
+    auto adder = lib.try_get_function<double(double, double)>("adder");
+    EXPECT_EQ(allocations, before);
+    EXPECT_FALSE(unknown);
+    EXPECT_FALSE(missing);
+    EXPECT_TRUE(adder);
+    EXPECT_NE(unknown.message().find("\"unknown\""), std::string::npos);
+}
+
+TEST(exported_symbols, basic_test) {
+    dylib lib("./", "dynamic_lib");
+    std::vector<std::string> expected = {"adder", "pi_value", "print_hello", "ptr"};
+    std::vector<std::string> found;
+
+    for (auto &symbol : lib.exported_symbols()) {
+        if (std::find(expected.begin(), expected.end(), symbol.name) != expected.end()) {
+            found.push_back(symbol.name);
+            EXPECT_EQ(symbol.address, lib.get_symbol(symbol.name));
+        }
+    }
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, expected);
+
+    dylib other(std::move(lib));
+    EXPECT_THROW(lib.exported_symbols(), std::logic_error);
+}
+
+TEST(find_symbols, prefix) {
+    dylib lib("./", "dynamic_lib");
+
+    auto symbols = lib.find_symbols("print");
+    ASSERT_EQ(symbols.size(), 1u);
+    EXPECT_STREQ(symbols[0].name, "print_hello");
+    EXPECT_EQ(symbols[0].address, lib.get_symbol("print_hello"));
+
+    EXPECT_TRUE(lib.find_symbols(std::string("no_such_prefix")).empty());
+    EXPECT_THROW(lib.find_symbols(nullptr), std::invalid_argument);
+}
+
+TEST(find_symbols, predicate) {
+    dylib lib("./", "dynamic_lib");
+
+    auto symbols = lib.find_symbols_if([](const dylib::exported_symbol &symbol) {
+        return std::strcmp(symbol.name, "adder") == 0 || std::strcmp(symbol.name, "pi_value") == 0;
+    });
+    EXPECT_EQ(symbols.size(), 2u);
+    for (auto &symbol : symbols)
+        EXPECT_EQ(symbol.address, lib.get_symbol(symbol.name));
+}
+
+TEST(exported_symbols, preload) {
+    dylib lib("./", "dynamic_lib");
+    EXPECT_GE(lib.preload_exported_symbols(), 4u);
+    EXPECT_TRUE(lib.symbol_cache_enabled());
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(5, 10), 15);
+}
+
+TEST(manifest, generated) {
+    dylib::manifest manifest("./", "dynamic_lib");
+    EXPECT_STREQ(manifest.abi(), "dylib-tests-1");
+    EXPECT_EQ(manifest.library_path(), dynamic_lib_path());
+    EXPECT_TRUE(manifest.has_symbol("adder"));
+    EXPECT_TRUE(manifest.has_symbol(std::string("pi_value")));
+    EXPECT_FALSE(manifest.has_symbol("missing_symbol"));
+    EXPECT_FALSE(manifest.has_symbol(nullptr));
+    EXPECT_EQ(manifest.name(manifest.size()), nullptr);
+
+    dylib lib(manifest.library_path(), dylib::no_filename_decorations);
+    lib.preload_manifest(manifest);
+    EXPECT_TRUE(lib.symbol_cache_enabled());
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(5, 10), 15);
+}
+
+TEST(manifest, write) {
+    dylib::manifest::write("./test.dlmanifest", "2.1", {"adder", "pi_value", "adder", "missing_symbol"});
+    dylib::manifest manifest("./test.dlmanifest");
+    EXPECT_STREQ(manifest.abi(), "2.1");
+    EXPECT_EQ(manifest.size(), 3u);
+    for (std::size_t i = 0; i < manifest.size(); i++)
+        EXPECT_TRUE(manifest.has_symbol(manifest.name(i)));
+
+    dylib lib("./", "dynamic_lib");
+    try {
+        lib.preload_manifest(manifest);
+        FAIL() << "preload_manifest should have thrown";
+    } catch (const dylib::symbol_error &e) {
+        EXPECT_NE(std::string(e.what()).find("\"missing_symbol\""), std::string::npos);
+    }
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(5, 10), 15);
+    std::remove("./test.dlmanifest");
+}
+
+TEST(manifest, invalid) {
+    EXPECT_THROW(dylib::manifest("./no_such.dlmanifest"), dylib::load_error);
+    const std::string library = dynamic_lib_path();
+    EXPECT_THROW(dylib::manifest{library}, dylib::load_error);
+
+    // a string offset past the string table, in the header then in the first entry
+    for (std::size_t offset : {std::size_t(12), std::size_t(32 + 8)}) {
+        dylib::manifest::write("./corrupt.dlmanifest", "2.1", {"adder"});
+        {
+            std::fstream file("./corrupt.dlmanifest", std::ios::in | std::ios::out | std::ios::binary);
+            const std::uint32_t out_of_range = 0xffff;
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(reinterpret_cast<const char *>(&out_of_range), sizeof(out_of_range));
+        }
+        EXPECT_THROW(dylib::manifest("./corrupt.dlmanifest"), dylib::load_error);
+    }
+    std::remove("./corrupt.dlmanifest");
+}
+
+#if defined(__GLIBC__)
+TEST(get_symbol, versioned) {
+    dylib lib("./", "dynamic_lib");
+
+    EXPECT_EQ(lib.get_function<int()>("versioned", "LIB_1.0")(), 1);
+    EXPECT_EQ(lib.get_function<int()>(std::string("versioned"), std::string("LIB_2.0"))(), 2);
+    EXPECT_EQ(lib.get_function<int()>("versioned")(), 2);
+    EXPECT_TRUE(lib.has_symbol("versioned", "LIB_1.0"));
+    EXPECT_FALSE(lib.has_symbol("versioned", "LIB_3.0"));
+    EXPECT_THROW(lib.get_symbol("versioned", "LIB_3.0"), dylib::symbol_error);
+    EXPECT_THROW(lib.get_symbol("versioned", nullptr), std::invalid_argument);
+
+    lib.enable_symbol_cache();
+    auto first = lib.get_symbol("versioned", "LIB_1.0");
+    EXPECT_EQ(lib.get_symbol("versioned", "LIB_1.0"), first);
+    EXPECT_NE(lib.get_symbol("versioned", "LIB_2.0"), first);
+    EXPECT_EQ(lib.get_symbol("versioned"), lib.get_symbol("versioned", "LIB_2.0"));
+
+    auto exported = lib.find_symbols_if([](const dylib::exported_symbol &symbol) {
+        return std::strcmp(symbol.name, "versioned") == 0;
+    });
+    ASSERT_EQ(exported.size(), 1u);
+    EXPECT_EQ(exported[0].address, lib.get_symbol("versioned", "LIB_2.0"));
+}
+#endif
+
 TEST(get_variable, alter_variables) {
     dylib lib("./", "dynamic_lib");
 
@@ -73,6 +568,38 @@ TEST(get_variable, alter_variables) {
     EXPECT_EQ(ptr1, &lib);
 }
 
+TEST(get_variable, variable_ref) {
+    dylib lib("./", "dynamic_lib");
+
+    dylib::variable_ref<double> empty;
+    EXPECT_FALSE(empty);
+    EXPECT_EQ(empty.address(), nullptr);
+
+    auto pi = lib.get_variable_ref<double>("pi_value");
+    EXPECT_TRUE(pi);
+    EXPECT_EQ(pi.address(), &lib.get_variable<double>("pi_value"));
+    EXPECT_EQ(lib.get_variable_ref<double>(std::string("pi_value")).address(), pi.address());
+    EXPECT_EQ(lib.get_variable_ref<double>(DYLIB_SYMBOL("pi_value")).address(), pi.address());
+    pi.store(2.5);
+    EXPECT_EQ(pi.load(std::memory_order_acquire), 2.5);
+    *pi = 3.14159;
+    EXPECT_EQ(pi.get(), 3.14159);
+    EXPECT_THROW(lib.get_variable_ref<double>("bad_symbol"), dylib::symbol_error);
+
+    auto counter = lib.get_variable_ref<int>("counter");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([counter] {
+            for (int i = 0; i < 1000; i++)
+                counter.load(std::memory_order_relaxed);
+        });
+    }
+    counter.store(42, std::memory_order_release);
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(counter.load(), 42);
+}
+
 TEST(invalid_argument, null_pointer) {
     try {
         dylib(nullptr);
@@ -105,6 +632,69 @@ TEST(manual_decorations, basic_test) {
     EXPECT_EQ(pi, 3.14159);
 }
 
+TEST(ctor, long_path) {
+    std::string dir_path;
+    while (dir_path.size() < 1024)
+        dir_path += "./";
+
+    dylib lib(dir_path, "dynamic_lib");
+    EXPECT_TRUE(lib.has_symbol("adder"));
+
+    try {
+        dylib(dir_path, "no_such_library");
+        EXPECT_EQ(true, false);
+    }
+    catch (const dylib::load_error &e) {
+        EXPECT_NE(std::string(e.what()).find(dir_path + dylib::filename_components::prefix + "no_such_library"),
+                  std::string::npos);
+    }
+}
+
+TEST(search_path, basic_test) {
+    dylib::search_path paths({"./no_such_directory", "."});
+    EXPECT_EQ(paths.directories().size(), 2u);
+
+    const std::string found = paths.find("dynamic_lib");
+    EXPECT_EQ(found, dynamic_lib_path());
+    EXPECT_TRUE(paths.find("no_such_library").empty());
+
+    dylib lib(paths, "dynamic_lib");
+    EXPECT_TRUE(lib.has_symbol("adder"));
+    EXPECT_THROW(dylib(paths, "no_such_library"), dylib::load_error);
+    EXPECT_THROW(dylib(dylib::search_path(), "dynamic_lib"), dylib::load_error);
+}
+
+TEST(search_path, cache) {
+    dylib::search_path paths({"."});
+    const std::string file_name = std::string(dylib::filename_components::prefix) + "search_path_tmp" +
+        dylib::filename_components::suffix;
+
+    std::remove(file_name.c_str());
+    EXPECT_TRUE(paths.find("search_path_tmp").empty());
+    std::ofstream(file_name).put('\0');
+    EXPECT_TRUE(paths.find("search_path_tmp").empty());
+    paths.clear_cache();
+    EXPECT_EQ(paths.find("search_path_tmp"), "./" + file_name);
+
+    dylib::search_path copy(paths);
+    std::remove(file_name.c_str());
+    EXPECT_EQ(copy.find("search_path_tmp"), "./" + file_name);
+    copy.add_directory("./no_such_directory");
+    EXPECT_TRUE(copy.find("search_path_tmp").empty());
+}
+
+#if !(defined(_WIN32) || defined(_WIN64))
+TEST(search_path, from_env) {
+    setenv("DYLIB_TEST_PATH", "./no_such_directory::/usr/lib", 1);
+    auto paths = dylib::search_path::from_env("DYLIB_TEST_PATH");
+    EXPECT_EQ(paths.directories(), std::vector<std::string>({"./no_such_directory", ".", "/usr/lib"}));
+    EXPECT_EQ(paths.find("dynamic_lib"), dynamic_lib_path());
+
+    unsetenv("DYLIB_TEST_PATH");
+    EXPECT_TRUE(dylib::search_path::from_env("DYLIB_TEST_PATH").directories().empty());
+}
+#endif
+
 TEST(std_move, basic_test) {
     try {
         dylib lib("./", "dynamic_lib");
@@ -132,6 +722,534 @@ TEST(has_symbol, basic_test) {
     EXPECT_FALSE(dummy.has_symbol("pi_value"));
 }
 
+TEST(symbol_cache, basic_test) {
+    dylib lib("./", "dynamic_lib");
+    EXPECT_FALSE(lib.symbol_cache_enabled());
+    lib.enable_symbol_cache();
+    EXPECT_TRUE(lib.symbol_cache_enabled());
+
+    auto adder = lib.get_function<double(double, double)>("adder");
+    EXPECT_EQ(adder, lib.get_function<double(double, double)>("adder"));
+    EXPECT_EQ(adder(1, 2), 3);
+    EXPECT_TRUE(lib.has_symbol("pi_value"));
+    EXPECT_EQ(lib.get_variable<double>("pi_value"), 3.14159);
+    EXPECT_FALSE(lib.has_symbol("bad_symbol"));
+    EXPECT_THROW(lib.get_symbol("bad_symbol"), dylib::symbol_error);
+
+    for (int i = 0; i < 64; i++)
+        EXPECT_FALSE(lib.has_symbol("bad_symbol_" + std::to_string(i)));
+    EXPECT_EQ(lib.get_symbol("adder"), lib.get_symbol(std::string("adder")));
+
+    lib.disable_symbol_cache();
+    EXPECT_FALSE(lib.symbol_cache_enabled());
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder"), adder);
+}
+
+TEST(symbol_cache, std_move) {
+    dylib lib("./", "dynamic_lib");
+    lib.enable_symbol_cache();
+    auto ptr = lib.get_symbol("ptr");
+
+    dylib other(std::move(lib));
+    EXPECT_TRUE(other.symbol_cache_enabled());
+    EXPECT_FALSE(lib.symbol_cache_enabled());
+    EXPECT_EQ(other.get_symbol("ptr"), ptr);
+    EXPECT_THROW(lib.get_symbol("ptr"), std::logic_error);
+
+    lib = std::move(other);
+    EXPECT_TRUE(lib.symbol_cache_enabled());
+    EXPECT_EQ(lib.get_symbol("ptr"), ptr);
+    EXPECT_THROW(other.get_symbol("ptr"), std::logic_error);
+}
+
+TEST(symbol_cache, concurrent_lookups) {
+    dylib reference("./", "dynamic_lib");
+    dylib lib("./", "dynamic_lib");
+    lib.enable_symbol_cache();
+
+    std::vector<std::string> names;
+    std::vector<dylib::native_symbol_type> expected;
+    for (auto &symbol : reference.exported_symbols()) {
+        names.emplace_back(symbol.name);
+        expected.push_back(reference.get_symbol(symbol.name));
+    }
+    ASSERT_FALSE(names.empty());
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&, t] {
+            const std::string missing = "missing_" + std::to_string(t);
+            for (std::size_t i = 0; i < 400; i++) {
+                const std::size_t index = (i * 7 + static_cast<std::size_t>(t)) % names.size();
+                if (lib.get_symbol(names[index]) != expected[index])
+                    failures++;
+                if (i % 8 != 0)
+                    continue;
+                try {
+                    lib.get_symbol(missing);
+                    failures++;
+                } catch (const dylib::symbol_error &e) {
+#if defined(__GLIBC__)
+                    // the loader description belongs to the failed lookup of this thread
+                    if (std::string(e.what()).find("undefined symbol: " + missing) == std::string::npos)
+                        failures++;
+#endif
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(failures.load(), 0);
+}
+
+TEST(symbol_cache, symbol_key) {
+    static_assert(DYLIB_SYMBOL("adder").hash() == 0x235decfdfd543243ULL, "FNV-1a hash of the symbol name");
+    static_assert(DYLIB_SYMBOL("adder").size() == 5, "length of the symbol name");
+    static constexpr char padded[16] = "adder";
+    static_assert(DYLIB_SYMBOL(padded).size() == 5 && DYLIB_SYMBOL(padded).hash() == DYLIB_SYMBOL("adder").hash(),
+        "length and hash of the string held by an array");
+    static_assert(!std::is_constructible<dylib::symbol_key, const char (&)[6]>::value, "keys are built by DYLIB_SYMBOL");
+
+    dylib lib("./", "dynamic_lib");
+    auto adder = lib.get_function<double(double, double)>(DYLIB_SYMBOL("adder"));
+    EXPECT_EQ(adder(1, 2), 3);
+
+    lib.enable_symbol_cache();
+    EXPECT_EQ(lib.get_function<double(double, double)>(DYLIB_SYMBOL("adder")), adder);
+    EXPECT_EQ(lib.get_function<double(double, double)>(DYLIB_SYMBOL(padded)), adder);
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder"), adder);
+    EXPECT_EQ(lib.get_variable<double>(DYLIB_SYMBOL("pi_value")), 3.14159);
+    EXPECT_THROW(lib.get_symbol(DYLIB_SYMBOL("bad_symbol")), dylib::symbol_error);
+#ifdef DYLIB_INSTRUMENTATION
+    EXPECT_EQ(lib.get_statistics().cache_hits, 2u);
+#endif
+
+    dylib empty(std::move(lib));
+    EXPECT_THROW(lib.get_symbol(DYLIB_SYMBOL("adder")), std::logic_error);
+}
+
+struct math_table {
+    double (*adder)(double, double);
+    void (*print_hello)();
+
+    static std::tuple<dylib::binding<math_table, double(double, double)>, dylib::binding<math_table, void()>> symbols() {
+        return std::make_tuple(dylib::bind_symbol(&math_table::adder, "adder"),
+                               dylib::bind_symbol(&math_table::print_hello, "print_hello"));
+    }
+};
+
+TEST(bind, basic_test) {
+    testing::internal::CaptureStdout();
+    dylib lib("./", "dynamic_lib");
+
+    auto table = lib.bind(dylib::bind_symbol(&math_table::adder, "adder"),
+                          dylib::bind_symbol(&math_table::print_hello, "print_hello"));
+    EXPECT_EQ(table.adder, lib.get_function<double(double, double)>("adder"));
+    EXPECT_EQ(table.adder(5, 10), 15);
+    table.print_hello();
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "Hello\n");
+
+    auto other = lib.bind<math_table>();
+    EXPECT_EQ(other.adder, table.adder);
+    EXPECT_EQ(other.print_hello, table.print_hello);
+}
+
+TEST(bind, bad_symbols) {
+    struct bad_table {
+        double (*adder)(double, double);
+        void (*first)();
+        int (*second)(int);
+    };
+    dylib lib("./", "dynamic_lib");
+
+    try {
+        lib.bind(dylib::bind_symbol(&bad_table::adder, "adder"),
+                 dylib::bind_symbol(&bad_table::first, "unknown_first"),
+                 dylib::bind_symbol(&bad_table::second, "unknown_second"));
+        EXPECT_EQ(true, false);
+    }
+    catch (const dylib::symbol_error &e) {
+        std::string message = e.what();
+        EXPECT_NE(message.find("\"unknown_first\", \"unknown_second\""), std::string::npos);
+        EXPECT_EQ(message.find("\"adder\""), std::string::npos);
+    }
+    EXPECT_THROW(lib.bind(dylib::bind_symbol(&bad_table::first, nullptr)), std::invalid_argument);
+
+    dylib other(std::move(lib));
+    EXPECT_THROW(lib.bind<math_table>(), std::logic_error);
+}
+
+TEST(lazy_function, basic_test) {
+    dylib lib("./", "dynamic_lib");
+
+    auto adder = lib.get_lazy_function<double(double, double)>("adder");
+    EXPECT_FALSE(adder.resolved());
+    EXPECT_EQ(adder(5, 10), 15);
+    EXPECT_TRUE(adder.resolved());
+    EXPECT_EQ(adder.get(), lib.get_function<double(double, double)>("adder"));
+
+    auto copy = adder;
+    EXPECT_TRUE(copy.resolved());
+    EXPECT_EQ(copy(1, 1), 2);
+}
+
+TEST(lazy_function, bad_symbol) {
+    dylib lib("./", "dynamic_lib");
+
+    auto unknown = lib.get_lazy_function<void()>("unknown");
+    EXPECT_THROW(unknown(), dylib::symbol_error);
+    EXPECT_FALSE(unknown.resolved());
+    EXPECT_THROW(lib.get_lazy_function<void()>(nullptr), std::invalid_argument);
+
+    dylib other(std::move(lib));
+    EXPECT_THROW(lib.get_lazy_function<void()>("adder"), std::logic_error);
+}
+
+TEST(lazy_function, concurrent_first_call) {
+    dylib lib("./", "dynamic_lib");
+    auto adder = lib.get_lazy_function<double(double, double)>("adder");
+
+    std::vector<std::thread> threads;
+    std::vector<double> results(8, 0);
+    for (std::size_t i = 0; i < results.size(); i++)
+        threads.emplace_back([&adder, &results, i]() { results[i] = adder(static_cast<double>(i), 1); });
+    for (auto &thread : threads)
+        thread.join();
+
+    for (std::size_t i = 0; i < results.size(); i++)
+        EXPECT_EQ(results[i], static_cast<double>(i) + 1);
+}
+
+TEST(memory_view, basic_test) {
+    std::ifstream file(dynamic_lib_path(), std::ios::binary);
+    std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    dylib first(dylib::memory_view{image.data(), image.size()});
+    dylib second(dylib::memory_view{image.data(), image.size()});
+    image.clear();
+
+    EXPECT_EQ(first.get_function<double(double, double)>("adder")(5, 10), 15);
+    EXPECT_EQ(second.get_variable<double>("pi_value"), 3.14159);
+    EXPECT_NE(first.native_handle(), second.native_handle());
+
+    dylib moved(std::move(first));
+    EXPECT_EQ(moved.get_function<double(double, double)>("adder")(1, 2), 3);
+
+    const char garbage[] = "not a library";
+    EXPECT_THROW(dylib(dylib::memory_view{garbage, sizeof(garbage)}), dylib::load_error);
+    EXPECT_THROW(dylib(dylib::memory_view{nullptr, 0}), std::invalid_argument);
+}
+
+TEST(prefault, basic_test) {
+    dylib lib("./", "dynamic_lib");
+
+    const std::size_t text = lib.prefault();
+    EXPECT_GT(text, 0u);
+    EXPECT_GT(lib.prefault(dylib::segments::all), text);
+    EXPECT_GE(lib.prefault(dylib::segments::text, true), text);
+
+    dylib other(std::move(lib));
+    EXPECT_THROW(lib.prefault(), std::logic_error);
+}
+
+TEST(prefault, load_options) {
+    dylib text("./", "dynamic_lib", dylib::add_filename_decorations, dylib::load_options::prefault_text);
+    dylib all("./", "dynamic_lib", dylib::add_filename_decorations,
+              dylib::load_options::prefault_all | dylib::load_options::lock_pages);
+    EXPECT_EQ(text.get_function<double(double, double)>("adder")(5, 10), 15);
+    EXPECT_EQ(all.get_variable<double>("pi_value"), 3.14159);
+
+    auto batch = dylib::load_all({dynamic_lib_path()}, 1, {}, dylib::load_options::prefault_text);
+    EXPECT_TRUE(batch.ok());
+}
+
+TEST(deferred_close, basic_test) {
+    dylib::set_close_delay(std::chrono::seconds(10));
+    {
+        dylib lib("./", "dynamic_lib", dylib::add_filename_decorations, dylib::load_options::deferred_close);
+        lib.get_variable<int>("counter") = 7;
+        dylib moved(std::move(lib));
+    }
+    EXPECT_EQ(dylib::pending_closes(), 1u);
+    {
+        // the destroyed library is still loaded during its grace period
+        dylib lib("./", "dynamic_lib");
+        EXPECT_EQ(lib.get_variable<int>("counter"), 7);
+        lib.get_variable<int>("counter") = 0;
+    }
+    dylib::flush_closes();
+    EXPECT_EQ(dylib::pending_closes(), 0u);
+
+    dylib::set_close_delay(std::chrono::milliseconds(0));
+    {
+        auto batch = dylib::load_all({dynamic_lib_path(), dynamic_lib_path()}, 2, {}, dylib::load_options::deferred_close);
+        EXPECT_TRUE(batch.ok());
+    }
+    dylib::flush_closes();
+    EXPECT_EQ(dylib::pending_closes(), 0u);
+}
+
+TEST(isolated, basic_test) {
+    dylib first("./", "dynamic_lib", dylib::add_filename_decorations, dylib::load_options::isolated);
+    dylib second("./", "dynamic_lib", dylib::add_filename_decorations, dylib::load_options::isolated);
+    dylib shared("./", "dynamic_lib");
+    EXPECT_NE(first.native_handle(), second.native_handle());
+    EXPECT_NE(first.native_handle(), shared.native_handle());
+
+    first.get_variable<int>("counter") = 1;
+    second.get_variable<int>("counter") = 2;
+    EXPECT_EQ(first.get_variable<int>("counter"), 1);
+    EXPECT_EQ(second.get_variable<int>("counter"), 2);
+    EXPECT_EQ(shared.get_variable<int>("counter"), 0);
+    EXPECT_EQ(second.get_function<double(double, double)>("adder")(5, 10), 15);
+
+    // more instances than private namespaces
+    std::vector<dylib> shards;
+    const bool decorations = dylib::add_filename_decorations;
+    for (int i = 0; i < 20; i++) {
+        shards.emplace_back("./", "dynamic_lib", decorations, dylib::load_options::isolated);
+        shards.back().get_variable<int>("counter") = i;
+    }
+    for (int i = 0; i < 20; i++)
+        EXPECT_EQ(shards[static_cast<std::size_t>(i)].get_variable<int>("counter"), i);
+
+#ifdef DYLIB_DLMOPEN
+    // only running out of namespaces falls back to a copy, other failures are reported as is
+    try {
+        dylib missing("./", "no_such_library", decorations, dylib::load_options::isolated);
+        EXPECT_EQ(true, false);
+    } catch (const dylib::load_error &e) {
+        EXPECT_EQ(std::string(e.what()).find("Could not copy"), std::string::npos);
+        EXPECT_NE(std::string(e.what()).find("no_such_library"), std::string::npos);
+    }
+#endif
+}
+
+TEST(numa_library, basic_test) {
+    dylib::numa_library lib("./", "dynamic_lib");
+    ASSERT_GE(lib.size(), 1u);
+    EXPECT_LT(lib.local_index(), lib.size());
+    EXPECT_EQ(&lib.local(), &lib.instance(lib.local_index()));
+    EXPECT_THROW(lib.instance(lib.size()), std::out_of_range);
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(5, 10), 15);
+    EXPECT_EQ(lib.get_function<double(double, double)>(std::string("adder")),
+              lib.local().get_function<double(double, double)>("adder"));
+
+    // every instance is private, with its own globals
+    dylib shared("./", "dynamic_lib");
+    lib.local().get_variable<int>("counter") = 5;
+    EXPECT_EQ(shared.get_variable<int>("counter"), 0);
+    EXPECT_NE(lib.local().native_handle(), shared.native_handle());
+}
+
+TEST(huge_pages, basic_test) {
+    // the code segment of the test library is too small to hold an aligned huge page,
+    // so the remap must leave it untouched and the library usable
+    dylib lib("./", "dynamic_lib", dylib::add_filename_decorations, dylib::load_options::huge_pages);
+    EXPECT_EQ(lib.huge_page_bytes(), 0u);
+    EXPECT_EQ(lib.remap_huge_pages(), 0u);
+    EXPECT_EQ(lib.get_function<double(double, double)>("adder")(5, 10), 15);
+
+    dylib other(std::move(lib));
+    EXPECT_THROW(lib.remap_huge_pages(), std::logic_error);
+}
+
+TEST(reloadable, basic_test) {
+    dylib::reloadable plugin("./", "dynamic_lib", {"adder", "pi_value"});
+    {
+        auto guard = plugin.acquire();
+        EXPECT_EQ(guard.generation(), 1u);
+        EXPECT_EQ(guard.get_function<double(double, double)>(0)(5, 10), 15);
+        EXPECT_EQ(guard.get_variable<double>(1), 3.14159);
+        EXPECT_TRUE(guard.library().has_symbol("print_hello"));
+    }
+    plugin.reload();
+    EXPECT_EQ(plugin.generation(), 2u);
+    EXPECT_EQ(plugin.acquire().get_function<double(double, double)>(0)(1, 2), 3);
+
+    EXPECT_THROW(dylib::reloadable("./", "dynamic_lib", {"adder", "unknown"}), dylib::symbol_error);
+    EXPECT_THROW(dylib::reloadable("./", "no_such_library", {}), dylib::load_error);
+}
+
+TEST(reloadable, deferred_close) {
+    dylib::reloadable plugin("./", "dynamic_lib", {"adder"});
+    auto guard = plugin.acquire();
+    auto adder = guard.get_function<double(double, double)>(0);
+
+    auto reload = std::async(std::launch::async, [&plugin]() { plugin.reload(); });
+    EXPECT_EQ(reload.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+    EXPECT_EQ(plugin.generation(), 2u);
+    EXPECT_EQ(adder(1, 2), 3);
+
+    { auto released = std::move(guard); }
+    reload.get();
+}
+
+#if !(defined(_WIN32) || defined(_WIN64))
+TEST(reloadable, read_only_directory) {
+    const std::string dir = "./read_only_plugins";
+    const std::string path = dir + "/" + dylib::filename_components::prefix + "dynamic_lib" + dylib::filename_components::suffix;
+    mkdir(dir.c_str(), 0755);
+    copy_library(dynamic_lib_path(), path);
+    chmod(dir.c_str(), 0555);
+    {
+        dylib::reloadable plugin(dir, "dynamic_lib", {"adder"});
+        plugin.reload();
+        EXPECT_EQ(plugin.generation(), 2u);
+        EXPECT_EQ(plugin.acquire().get_function<double(double, double)>(0)(1, 2), 3);
+    }
+    chmod(dir.c_str(), 0755);
+    std::remove(path.c_str());
+    rmdir(dir.c_str());
+}
+#endif
+
+TEST(reloadable, watch) {
+    const std::string name = "reloadable_lib";
+    const std::string path = "./" + (dylib::filename_components::prefix + name) + dylib::filename_components::suffix;
+    copy_library(dynamic_lib_path(), path);
+
+    std::promise<std::exception_ptr> reloaded;
+    std::atomic<bool> notified{false};
+    {
+        dylib::reloadable plugin("./", name, {"adder"});
+        plugin.watch([&reloaded, &notified](std::exception_ptr error) {
+            if (!notified.exchange(true))
+                reloaded.set_value(error);
+        });
+
+        copy_library(dynamic_lib_path(), path);
+        auto result = reloaded.get_future();
+        ASSERT_EQ(result.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+        EXPECT_EQ(result.get(), nullptr);
+        plugin.stop_watching();
+        EXPECT_EQ(plugin.generation(), 2u);
+    }
+    std::remove(path.c_str());
+}
+
+#ifdef DYLIB_INSTRUMENTATION
+struct counting_observer : public dylib::observer {
+    int opens = 0;
+    int lookups = 0;
+    int cache_hits = 0;
+    int closes = 0;
+
+    void on_open(const char *, dylib::native_handle_type, std::chrono::nanoseconds) override {
+        opens++;
+    }
+
+    void on_lookup(dylib::native_handle_type, const char *, dylib::native_symbol_type, bool cache_hit,
+                   std::chrono::nanoseconds) override {
+        lookups++;
+        cache_hits += cache_hit;
+    }
+
+    void on_close(dylib::native_handle_type, std::chrono::nanoseconds) override {
+        closes++;
+    }
+};
+
+TEST(instrumentation, statistics) {
+    dylib lib("./", "dynamic_lib");
+    lib.enable_symbol_cache();
+    lib.get_symbol("adder");
+    lib.get_symbol("adder");
+    EXPECT_FALSE(lib.has_symbol("unknown"));
+
+    auto stats = lib.get_statistics();
+    EXPECT_EQ(stats.path, dynamic_lib_path());
+    EXPECT_GT(stats.load_time.count(), 0);
+    EXPECT_EQ(stats.lookups, 3u);
+    EXPECT_EQ(stats.cache_hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_DOUBLE_EQ(stats.cache_hit_ratio(), 1.0 / 3.0);
+
+    std::ostringstream out;
+    lib.dump_statistics(out);
+    EXPECT_NE(out.str().find("3 lookups"), std::string::npos);
+
+    dylib other(std::move(lib));
+    EXPECT_EQ(other.get_statistics().lookups, 3u);
+    EXPECT_EQ(lib.get_statistics().lookups, 0u);
+
+    auto batch = dylib::load_all({dynamic_lib_path()});
+    EXPECT_EQ(batch.libraries[0].get_statistics().path, dynamic_lib_path());
+}
+
+TEST(instrumentation, observer) {
+    counting_observer watcher;
+    dylib::set_observer(&watcher);
+    {
+        dylib lib("./", "dynamic_lib");
+        lib.get_function<double(double, double)>("adder");
+        EXPECT_THROW(dylib("./", "no_such_library"), dylib::load_error);
+    }
+    dylib::set_observer(nullptr);
+    dylib("./", "dynamic_lib").has_symbol("adder");
+
+    EXPECT_EQ(watcher.opens, 2);
+    EXPECT_EQ(watcher.lookups, 1);
+    EXPECT_EQ(watcher.cache_hits, 0);
+    EXPECT_EQ(watcher.closes, 1);
+}
+
+struct throwing_observer : public dylib::observer {
+    void on_open(const char *, dylib::native_handle_type, std::chrono::nanoseconds) override {
+        throw std::runtime_error("on_open");
+    }
+
+    void on_lookup(dylib::native_handle_type, const char *, dylib::native_symbol_type, bool,
+                   std::chrono::nanoseconds) override {
+        throw std::runtime_error("on_lookup");
+    }
+
+    void on_close(dylib::native_handle_type, std::chrono::nanoseconds) override {
+        throw std::runtime_error("on_close");
+    }
+};
+
+// opens another library through the registry while the registry is loading one
+struct reentrant_observer : public dylib::observer {
+    explicit reentrant_observer(dylib::registry &owner) : registry(owner) {}
+
+    void on_open(const char *path, dylib::native_handle_type, std::chrono::nanoseconds) override {
+        if (!inner && std::strstr(path, "registry_lib") == nullptr)
+            inner = registry.open("./", "registry_lib");
+    }
+
+    dylib::registry &registry;
+    shared_dylib inner{};
+};
+
+TEST(instrumentation, reentrant_registry) {
+    copy_library(dynamic_lib_path(), "./" + (dylib::filename_components::prefix + std::string("registry_lib")) +
+                 dylib::filename_components::suffix);
+    dylib::registry registry;
+    reentrant_observer watcher(registry);
+    dylib::set_observer(&watcher);
+    shared_dylib outer = registry.open("./", "dynamic_lib");
+    dylib::set_observer(nullptr);
+
+    ASSERT_TRUE(watcher.inner);
+    EXPECT_NE(watcher.inner, outer);
+    EXPECT_EQ(registry.size(), 2u);
+}
+
+TEST(instrumentation, throwing_observer) {
+    throwing_observer watcher;
+    dylib::set_observer(&watcher);
+    {
+        dylib lib("./", "dynamic_lib");
+        EXPECT_TRUE(lib.has_symbol("adder"));
+        EXPECT_FALSE(lib.try_get_symbol("unknown"));
+    }
+    dylib::set_observer(nullptr);
+}
+#endif
+
 TEST(handle_management, basic_test) {
     dylib lib("./", "dynamic_lib");
     EXPECT_FALSE(lib.native_handle() == nullptr);
@@ -182,6 +1300,21 @@ TEST(filesystem, basic_test) {
 }
 #endif
 
+#if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+TEST(string_view, basic_test) {
+    const char buffer[] = "./dynamic_lib";
+    std::string_view dir_path(buffer, 2);
+    std::string_view lib_name(buffer + 2);
+
+    dylib lib(dir_path, lib_name);
+    EXPECT_TRUE(lib.has_symbol("pi_value"));
+    EXPECT_TRUE(dylib(dir_path, "dynamic_lib").has_symbol("pi_value"));
+    EXPECT_TRUE(dylib(dir_path, std::string("dynamic_lib")).has_symbol("pi_value"));
+    EXPECT_THROW(dylib(std::string_view("./"), std::string_view("no_such_library")), dylib::load_error);
+    EXPECT_THROW(dylib(dir_path, static_cast<const char *>(nullptr)), std::invalid_argument);
+}
+#endif
+
 int main(int ac, char **av) {
     testing::InitGoogleTest(&ac, av);
     return RUN_ALL_TESTS();
@@ -0,0 +1,68 @@
+/*
+ *  Prints the dependency graph of dynamic libraries in load order, see dylib::dependency_graph.
+ *  With --preload, also opens the dependencies that are not loaded yet and reports the time spent
+ *
+ *  usage: dylib_deps [--preload] [--threads <count>] <library path>...
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "dylib.hpp"
+
+static int usage(const char *program) {
+    std::cerr << "usage: " << program << " [--preload] [--threads <count>] <library path>..." << std::endl;
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    bool preload = false;
+    unsigned threads = 0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--preload") == 0)
+            preload = true;
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (argv[i][0] == '-')
+            return usage(argv[0]);
+        else
+            paths.emplace_back(argv[i]);
+    }
+    if (paths.empty())
+        return usage(argv[0]);
+
+    try {
+        dylib::dependency_graph graph(paths);
+        const auto &libraries = graph.libraries();
+        for (auto index : graph.load_order()) {
+            const auto &lib = libraries[index];
+            std::cout << (lib.path.empty() ? lib.name + " (not found, searched by the loader)" : lib.path);
+            if (lib.root)
+                std::cout << " [root]";
+            else if (lib.loaded)
+                std::cout << " [loaded]";
+            else if (lib.required_by > 1)
+                std::cout << " [shared by " << lib.required_by << " roots]";
+            std::cout << "\n";
+            for (auto dependency : lib.dependencies)
+                std::cout << "    " << libraries[dependency].name << "\n";
+        }
+
+        if (preload) {
+            const auto report = graph.preload(threads);
+            for (const auto &failure : report.errors)
+                std::cerr << failure.error.what() << std::endl;
+            std::cout << "preloaded " << report.preloaded << " libraries in " << report.elapsed.count() / 1000
+                      << "us, " << report.advise_time.count() / 1000 << "us of them in read-ahead advice calls" << std::endl;
+            if (!report.errors.empty())
+                return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ *  Generates the manifest of a dynamic library, see dylib::manifest
+ *
+ *  usage: dylib_manifest <library path> <manifest path> [abi tag]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "dylib.hpp"
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "usage: " << argv[0] << " <library path> <manifest path> [abi tag]" << std::endl;
+        return 2;
+    }
+
+    try {
+        dylib lib(argv[1], dylib::no_filename_decorations);
+
+        std::vector<std::string> symbols;
+        for (auto &symbol : lib.exported_symbols())
+            symbols.emplace_back(symbol.name);
+
+        dylib::manifest::write(argv[2], argc == 4 ? argv[3] : "", std::move(symbols));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}